@@ -0,0 +1,129 @@
+// Decode time and peak memory of the preview images per image format.
+//
+// Usage: preview_benchmark <image folder>
+//
+// Every format of the folder is measured in a child process of its own, so that the peak memory (max. RSS)
+// of one format is not hidden by another one. Both ways of creating a preview are measured:
+// - "scaled":  ThumbnailLoader::createPreviewImage(), which lets the decoder produce the preview size directly
+// - "full":    decoding the full image and scaling it down afterwards
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMap>
+#include <QProcess>
+#include <QTextStream>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include "thumbnail_loader.h"
+
+namespace
+{
+QTextStream out(stdout);
+
+// Max. resident set size of this process in KiB, -1 if unknown
+long peakMemoryKiB()
+{
+#ifdef Q_OS_UNIX
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef Q_OS_MACOS
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#else
+  return -1;
+#endif
+}
+
+QImage createFullPreviewImage(const QString& image_path)
+{
+  return QImageReader(image_path)
+      .read()
+      .scaled(QSize(128, 128), Qt::KeepAspectRatio, Qt::FastTransformation)
+      .convertToFormat(QImage::Format_RGB888);
+}
+
+// Runs in the child process: measures one format with one method
+int measure(const QString& folder, const QString& suffix, const QString& method)
+{
+  const QDir dir(folder);
+  const QStringList image_filenames = dir.entryList({"*." + suffix}, QDir::Files, QDir::Name);
+
+  const long memory_before = peakMemoryKiB();
+
+  QElapsedTimer timer;
+  timer.start();
+
+  int num_failed = 0;
+  for (const QString& image_filename : image_filenames)
+  {
+    const QString image_path = dir.absoluteFilePath(image_filename);
+    const QImage preview_image =
+        method == "scaled" ? ThumbnailLoader::createPreviewImage(image_path) : createFullPreviewImage(image_path);
+
+    if (preview_image.isNull())
+    {
+      num_failed++;
+    }
+  }
+
+  const qint64 elapsed_ms = timer.elapsed();
+
+  out << suffix << "\t" << method << "\t" << image_filenames.size() << "\t" << num_failed << "\t"
+      << QString::number(image_filenames.isEmpty() ? 0. : double(elapsed_ms) / image_filenames.size(), 'f', 2) << "\t"
+      << peakMemoryKiB() << "\t" << (peakMemoryKiB() - memory_before) << "\n";
+
+  return 0;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  const QStringList arguments = app.arguments();
+
+  if (arguments.size() == 4)
+  {
+    return measure(arguments.at(1), arguments.at(2), arguments.at(3));
+  }
+
+  if (arguments.size() != 2)
+  {
+    out << "Usage: " << QFileInfo(arguments.at(0)).fileName() << " <image folder>\n";
+    return 1;
+  }
+
+  const QString folder = arguments.at(1);
+
+  // The formats of the folder, the same ones the ImageListModel shows
+  QMap<QString, int> num_images_by_suffix;
+  for (const QFileInfo& file_info :
+       QDir(folder).entryInfoList({"*.jpg", "*.jpeg", "*.png", "*.webp"}, QDir::Files, QDir::Name))
+  {
+    num_images_by_suffix[file_info.suffix()]++;
+  }
+
+  out << "format\tmethod\timages\tfailed\tms/image\tpeak KiB\tpeak growth KiB\n";
+  out.flush();
+
+  for (const QString& suffix : num_images_by_suffix.keys())
+  {
+    for (const QString method : {"scaled", "full"})
+    {
+      QProcess process;
+      process.setProcessChannelMode(QProcess::ForwardedChannels);
+      process.start(arguments.at(0), {folder, suffix, method});
+      process.waitForFinished(-1);
+    }
+  }
+
+  return 0;
+}
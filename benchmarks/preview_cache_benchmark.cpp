@@ -0,0 +1,220 @@
+// Lookup time and memory of the preview cache backends (ATLAS vs. SQLITE).
+//
+// Usage: preview_cache_benchmark [number of previews]
+//
+// Both backends are filled with the same generated previews through CacheDBConnection, each in a temporary folder.
+// Then every backend is read back in a fresh child process, so that its in-memory cache starts empty and the peak
+// memory (max. RSS) only covers that backend. All previews are read twice, the same way ImageListModel does it:
+// - "cold": nothing is in the in-memory cache of the connection yet (the OS file cache is warm from filling it)
+// - "warm": the second pass, which hits the in-memory cache as far as its budget allows
+// Per preview, the time of the lookup and of wrapping (ATLAS) or decoding (SQLITE) it is reported. The pixels are read
+// in both cases, so that the memory mapped previews of the atlas are actually paged in.
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImage>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include "cache_db_interface.h"
+
+namespace
+{
+QTextStream out(stdout);
+
+// The pixels that were read end up here, so that reading them is not optimized away
+volatile quint64 pixel_sink = 0;
+
+// Max. resident set size of this process in KiB, -1 if unknown
+long peakMemoryKiB()
+{
+#ifdef Q_OS_UNIX
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef Q_OS_MACOS
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#else
+  return -1;
+#endif
+}
+
+QString md5Hash(const int i)
+{
+  return QCryptographicHash::hash(QByteArray::number(i), QCryptographicHash::Md5).toHex();
+}
+
+int filesize(const int i)
+{
+  return 100000 + i;
+}
+
+// A smooth gradient with some noise, so that the codecs have something to do (like a downscaled photo)
+QImage createPreviewImage(const int i)
+{
+  QRandomGenerator random(i);
+
+  QImage image(PreviewAtlas::max_preview_size, PreviewAtlas::max_preview_size * 3 / 4, QImage::Format_RGB888);
+  for (int y = 0; y < image.height(); y++)
+  {
+    uchar* line = image.scanLine(y);
+    for (int x = 0; x < image.width(); x++)
+    {
+      line[3 * x + 0] = uchar(x * 2 + random.bounded(8));
+      line[3 * x + 1] = uchar(y * 2 + random.bounded(8));
+      line[3 * x + 2] = uchar(i + random.bounded(8));
+    }
+  }
+
+  return image;
+}
+
+PreviewCacheBackend backendFromName(const QString& name)
+{
+  return name == "atlas" ? PreviewCacheBackend::ATLAS : PreviewCacheBackend::SQLITE;
+}
+
+// Runs in a child process: stores the previews (the destructor of the connection waits until they are written)
+int fill(const QString& backend, const QString& root_path, const int num_previews)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  {
+    CacheDBConnection cache_db(QDir(root_path), backendFromName(backend));
+
+    for (int i = 0; i < num_previews; i++)
+    {
+      cache_db.storePreviewImage(md5Hash(i), filesize(i), createPreviewImage(i));
+    }
+  }
+
+  out << backend << "\tfill\t" << num_previews << "\t0\t"
+      << QString::number(double(timer.nsecsElapsed()) / 1000. / num_previews, 'f', 2) << "\t-\t" << peakMemoryKiB() << "\n";
+
+  return 0;
+}
+
+// Runs in a child process: reads all previews twice
+int lookup(const QString& backend, const QString& root_path, const int num_previews)
+{
+  CacheDBConnection cache_db(QDir(root_path), backendFromName(backend));
+
+  // The hashes are not part of the measured time
+  QStringList md5_hashes;
+  for (int i = 0; i < num_previews; i++)
+  {
+    md5_hashes.push_back(md5Hash(i));
+  }
+
+  for (const QString pass : {"cold", "warm"})
+  {
+    qint64 lookup_ns = 0;
+    qint64 decode_ns = 0;
+    int num_missing = 0;
+    quint64 checksum = 0;
+
+    QElapsedTimer timer;
+
+    for (int i = 0; i < num_previews; i++)
+    {
+      timer.start();
+
+      // Same order as ImageListModel::data(): the in-memory cache (and the atlas), then the database
+      std::optional<QImage> preview_image = cache_db.getCachedPreviewImage(md5_hashes.at(i), filesize(i));
+      std::optional<EncodedPreviewImage> encoded_preview_image;
+      if (!preview_image)
+      {
+        encoded_preview_image = cache_db.getEncodedPreviewImage(md5_hashes.at(i), filesize(i));
+      }
+
+      lookup_ns += timer.nsecsElapsed();
+      timer.start();
+
+      if (encoded_preview_image)
+      {
+        preview_image = PreviewImageCodec::decode(*encoded_preview_image);
+        cache_db.cachePreviewImage(md5_hashes.at(i), filesize(i), *preview_image);
+      }
+
+      if (!preview_image || preview_image->isNull())
+      {
+        num_missing++;
+      }
+      else
+      {
+        for (int y = 0; y < preview_image->height(); y += 8)
+        {
+          checksum += preview_image->constScanLine(y)[0];
+        }
+      }
+
+      decode_ns += timer.nsecsElapsed();
+    }
+
+    out << backend << "\t" << pass << "\t" << num_previews << "\t" << num_missing << "\t"
+        << QString::number(double(lookup_ns) / 1000. / num_previews, 'f', 2) << "\t"
+        << QString::number(double(decode_ns) / 1000. / num_previews, 'f', 2) << "\t" << peakMemoryKiB() << "\n";
+    out.flush();
+
+    pixel_sink = checksum;
+  }
+
+  return 0;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  const QStringList arguments = app.arguments();
+
+  if (arguments.size() == 5)
+  {
+    const QString mode = arguments.at(1);
+    const int num_previews = arguments.at(4).toInt();
+
+    return mode == "fill" ? fill(arguments.at(2), arguments.at(3), num_previews)
+                          : lookup(arguments.at(2), arguments.at(3), num_previews);
+  }
+
+  if (arguments.size() > 2)
+  {
+    out << "Usage: " << QFileInfo(arguments.at(0)).fileName() << " [number of previews]\n";
+    return 1;
+  }
+
+  const int num_previews = arguments.size() == 2 ? std::max(1, arguments.at(1).toInt()) : 20000;
+
+  // For "fill", the store/lookup column is the time to store a preview (incl. encoding and writing it)
+  out << "backend\tpass\tpreviews\tmissing\tstore/lookup us/preview\twrap/decode us/preview\tpeak KiB\n";
+  out.flush();
+
+  for (const QString backend : {"atlas", "sqlite"})
+  {
+    const QTemporaryDir root_path;
+
+    for (const QString mode : {"fill", "lookup"})
+    {
+      QProcess process;
+      process.setProcessChannelMode(QProcess::ForwardedChannels);
+      process.start(arguments.at(0), {mode, backend, root_path.path(), QString::number(num_previews)});
+      process.waitForFinished(-1);
+    }
+  }
+
+  return 0;
+}
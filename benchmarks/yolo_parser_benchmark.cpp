@@ -0,0 +1,125 @@
+// Throughput of the YOLO label parser.
+//
+// Usage: yolo_parser_benchmark [label folder]
+//
+// Without a folder, generated label data (detections and predictions with a confidence) is parsed.
+// With a folder, all of its *.txt files are read into memory first, so that only the parsing is measured.
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include "yolo_label_parser.h"
+
+namespace
+{
+QTextStream out(stdout);
+
+QList<QByteArray> generateLabelFiles(const int num_files, const int num_lines_per_file)
+{
+  QRandomGenerator random(42);
+
+  QList<QByteArray> files;
+  files.reserve(num_files);
+
+  for (int i = 0; i < num_files; i++)
+  {
+    QByteArray data;
+    for (int line = 0; line < num_lines_per_file; line++)
+    {
+      data += QByteArray::number(random.bounded(80)) + ' ' + QByteArray::number(random.generateDouble(), 'f', 6) + ' ' +
+              QByteArray::number(random.generateDouble(), 'f', 6) + ' ' + QByteArray::number(random.generateDouble(), 'f', 6) +
+              ' ' + QByteArray::number(random.generateDouble(), 'f', 6);
+      if (i % 2 == 1)
+      {
+        data += ' ' + QByteArray::number(random.generateDouble(), 'f', 4);
+      }
+      data += '\n';
+    }
+    files.push_back(data);
+  }
+
+  return files;
+}
+
+QList<QByteArray> readLabelFiles(const QString& folder)
+{
+  const QDir dir(folder);
+
+  QList<QByteArray> files;
+  for (const QString& label_filename : dir.entryList({"*.txt"}, QDir::Files, QDir::Name))
+  {
+    QFile file(dir.absoluteFilePath(label_filename));
+    if (file.open(QIODevice::ReadOnly))
+    {
+      files.push_back(file.readAll());
+    }
+  }
+
+  return files;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  const QStringList arguments = app.arguments();
+
+  if (arguments.size() > 2)
+  {
+    out << "Usage: yolo_parser_benchmark [label folder]\n";
+    return 1;
+  }
+
+  const QList<QByteArray> files = arguments.size() == 2 ? readLabelFiles(arguments.at(1)) : generateLabelFiles(10000, 20);
+
+  qint64 num_bytes = 0;
+  for (const QByteArray& data : files)
+  {
+    num_bytes += data.size();
+  }
+
+  // The best of a few runs, the first one also warms up the caches
+  const int num_runs = 5;
+
+  qint64 best_elapsed_ns = -1;
+  qint64 num_annotations = 0;
+  qint64 num_errors = 0;
+
+  for (int run = 0; run < num_runs; run++)
+  {
+    num_annotations = 0;
+    num_errors = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (const QByteArray& data : files)
+    {
+      const YoloLabels labels = YoloLabelParser::parse(data);
+      num_annotations += labels.annotations.size();
+      num_errors += labels.errors.size();
+    }
+
+    const qint64 elapsed_ns = timer.nsecsElapsed();
+    if (best_elapsed_ns < 0 || elapsed_ns < best_elapsed_ns)
+    {
+      best_elapsed_ns = elapsed_ns;
+    }
+  }
+
+  const double elapsed_s = std::max(best_elapsed_ns, qint64(1)) / 1e9;
+
+  out << "files\tannotations\terrors\tMB\tms\tMB/s\tannotations/s\n";
+  out << files.size() << "\t" << num_annotations << "\t" << num_errors << "\t" << QString::number(num_bytes / 1e6, 'f', 2)
+      << "\t" << QString::number(elapsed_s * 1e3, 'f', 2) << "\t" << QString::number(num_bytes / 1e6 / elapsed_s, 'f', 1)
+      << "\t" << QString::number(num_annotations / elapsed_s, 'f', 0) << "\n";
+
+  return 0;
+}
@@ -1,16 +1,31 @@
 #include "annotation_manager.h"
+#include "yolo_label_parser.h"
 
 #include <QFile>
+#include <QSet>
 
 AnnotationManager::AnnotationManager(ImageView* image_view, const QStringList& label_names)
     : image_view_(image_view),
       label_names_(label_names)
 {
+  bounding_boxes_item_ = new BoundingBoxesItem(annotations_, bbox_grid_, label_names_);
+}
+
+AnnotationManager::~AnnotationManager()
+{
+  releaseItems();
+  qDeleteAll(unused_items_);
+
+  if (bounding_boxes_item_->scene())
+  {
+    bounding_boxes_item_->scene()->removeItem(bounding_boxes_item_);
+  }
+  delete bounding_boxes_item_;
 }
 
 int AnnotationManager::rowCount(const QModelIndex& parent) const
 {
-  return annotation_bounding_boxes_.size();
+  return annotations_.size();
 }
 
 int AnnotationManager::columnCount(const QModelIndex& parent) const
@@ -30,13 +45,13 @@ QVariant AnnotationManager::data(const QModelIndex& index, int role) const
     switch (index.column())
     {
     case Columns::LABEL_ID:
-      return label_names_.at(annotation_bounding_boxes_.at(index.row())->labelID());
+      return label_names_.at(annotations_.labelID(index.row()));
 
     case Columns::WIDTH:
-      return std::round(annotation_bounding_boxes_.at(index.row())->rect().width());
+      return std::round(annotations_.rect(index.row()).width());
 
     case Columns::HEIGHT:
-      return std::round(annotation_bounding_boxes_.at(index.row())->rect().height());
+      return std::round(annotations_.rect(index.row()).height());
     }
   }
 
@@ -71,37 +86,37 @@ void AnnotationManager::loadFromFile(const QString& label_filename, const QSize&
 
   this->clear();
 
-  this->beginResetModel();
+  annotations_.setImageSize(image_size);
 
-  bool annotations_updated = false;
+  // Roughly 64 cells along the longer image side
+  bbox_grid_.clear(std::max(32.f, std::max(image_size.width(), image_size.height()) / 64.f));
 
-  QFile file(label_filename);
-  if (file.open(QIODevice::ReadOnly))
-  {
-    QTextStream in(&file);
+  this->beginResetModel();
 
-    while (!in.atEnd())
-    {
-      QString line = in.readLine();
+  const YoloLabels labels = YoloLabelParser::parseFile(label_filename);
 
-      QStringList fields = line.split(" ");
+  // Invalid lines are skipped, so the file is only saved again once the user edits the boxes (see saveToFile())
+  this->load_errors_ = !labels.errors.isEmpty();
+  for (const QString& error : labels.errors)
+  {
+    qWarning() << "Invalid annotation in" << label_filename << error;
+  }
 
-      if (!std::isfinite(fields[1].toFloat()) || !std::isfinite(fields[2].toFloat()) || !std::isfinite(fields[3].toFloat()))
-      {
-        qDebug() << "Found nan in " << label_filename;
-        annotations_updated = true;
-        std::terminate();
-      }
+  annotations_.reserve(labels.annotations.size());
 
-      if (fields.size() >= 5)
-      {
-        this->add(new AnnotationBoundingBox(fields, image_size, label_names_));
-      }
-    }
+  for (const YoloAnnotation& annotation : labels.annotations)
+  {
+    const QRectF rect =
+        AnnotationStore::rectFromYolo(annotation.x_center, annotation.y_center, annotation.width, annotation.height, image_size);
 
-    file.close();
+    const int bbox_index = annotations_.append(annotation.label_id, rect);
+    bbox_grid_.append(annotations_.rect(bbox_index));
   }
 
+  // All loaded boxes are drawn by a single item
+  bounding_boxes_item_->reset();
+  showBoundingBoxesItem();
+
   // Select the first bounding box
   if (auto_select_first_bbox)
   {
@@ -111,9 +126,9 @@ void AnnotationManager::loadFromFile(const QString& label_filename, const QSize&
 
     if (prefered_label_id_)
     {
-      for (int i = 0; i < annotation_bounding_boxes_.size(); i++)
+      for (int i = 0; i < annotations_.size(); i++)
       {
-        if (annotation_bounding_boxes_.at(i)->labelID() == prefered_label_id_.value())
+        if (annotations_.labelID(i) == prefered_label_id_.value())
         {
           select(i);
           selected = true;
@@ -129,13 +144,9 @@ void AnnotationManager::loadFromFile(const QString& label_filename, const QSize&
   }
 
   this->cleared_ = false;
+  this->edited_ = false;
 
   this->endResetModel();
-
-  // if (annotations_updated)
-  // {
-  //   this->save();
-  // }
 }
 
 void AnnotationManager::setLabelOutputFilename(const QString& output_label_filename)
@@ -152,10 +163,16 @@ void AnnotationManager::saveToFile(const QString& label_filename)
     return;
   }
 
+  // Do not drop the invalid lines of a file that was not edited
+  if (this->load_errors_ && !this->edited_)
+  {
+    return;
+  }
+
   QFile file(label_filename);
 
   // Do not create empty (useless) files
-  if (!file.exists() && this->annotation_bounding_boxes_.size() == 0)
+  if (!file.exists() && this->annotations_.isEmpty())
   {
     return;
   }
@@ -163,9 +180,9 @@ void AnnotationManager::saveToFile(const QString& label_filename)
   if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
   {
     QTextStream stream(&file);
-    for (const auto* bbox : annotation_bounding_boxes_)
+    for (int i = 0; i < annotations_.size(); i++)
     {
-      stream << bbox->toString() << Qt::endl;
+      stream << annotations_.toString(i) << Qt::endl;
     }
 
     file.close();
@@ -180,45 +197,59 @@ void AnnotationManager::save()
   }
 }
 
-void AnnotationManager::add(AnnotationBoundingBox* new_bbox)
+void AnnotationManager::add(const QRectF& rect, const int label_id)
 {
-  annotation_bounding_boxes_.push_back(new_bbox);
-
-  if (new_bbox->labelID() == -1)
-  {
-    new_bbox->setLabelID(active_label_);
-  }
+  const int bbox_index = annotations_.append(label_id, rect);
+  bbox_grid_.append(annotations_.rect(bbox_index));
+  this->edited_ = true;
 
   // Show item!
-  image_view_->scene()->addItem(new_bbox);
+  showBoundingBoxesItem();
+  boundingBoxChanged(bbox_index, QRectF());
 }
 
 void AnnotationManager::clear()
 {
-  annotation_bounding_boxes_.clear();
+  // The items are kept for the next image
+  releaseItems();
+
+  if (bounding_boxes_item_->scene())
+  {
+    bounding_boxes_item_->scene()->removeItem(bounding_boxes_item_);
+  }
+
+  annotations_.clear();
+  bbox_grid_.clear();
+  selected_bbox_id_.reset();
+  hovered_bbox_id_.reset();
   this->cleared_ = true;
+  this->edited_ = false;
 }
 
 void AnnotationManager::select(int bbox_index)
 {
-  if (this->annotation_bounding_boxes_.size() > bbox_index)
+  if (this->annotations_.size() > bbox_index)
   {
-    annotation_bounding_boxes_[bbox_index]->select();
     selected_bbox_id_ = bbox_index;
+    updateItems();
+
+    items_[bbox_index]->select();
   }
 }
 
 void AnnotationManager::unselect(int bbox_index)
 {
-  if (this->annotation_bounding_boxes_.size() > bbox_index)
+  if (items_.contains(bbox_index))
   {
-    annotation_bounding_boxes_[bbox_index]->unselect();
+    items_[bbox_index]->unselect();
   }
 
   if (selected_bbox_id_ && selected_bbox_id_.value() == bbox_index)
   {
     selected_bbox_id_.reset();
   }
+
+  updateItems();
 }
 
 void AnnotationManager::selectPrevious()
@@ -230,14 +261,14 @@ void AnnotationManager::selectPrevious()
 
     if (next_bbox_id < 0)
     {
-      next_bbox_id = this->annotation_bounding_boxes_.size() - 1;
+      next_bbox_id = this->annotations_.size() - 1;
     }
 
     this->unselect(*selected_bbox_id_);
     this->select(next_bbox_id);
   }
   // If no bounding box is selected, select the first one
-  else if (annotation_bounding_boxes_.size() > 0)
+  else if (!annotations_.isEmpty())
   {
     this->select(0);
   }
@@ -255,12 +286,12 @@ void AnnotationManager::selectNext()
       int num_bboxes_checked = 0;
       for (int i = selected_bbox_id_.value() + 1;; i++)
       {
-        if (i >= annotation_bounding_boxes_.size())
+        if (i >= annotations_.size())
         {
           i = 0;
         }
 
-        if (annotation_bounding_boxes_.at(i)->labelID() == prefered_label_id_.value())
+        if (annotations_.labelID(i) == prefered_label_id_.value())
         {
           next_bbox_id = i;
           break;
@@ -268,7 +299,7 @@ void AnnotationManager::selectNext()
 
         num_bboxes_checked++;
 
-        if (num_bboxes_checked >= annotation_bounding_boxes_.size())
+        if (num_bboxes_checked >= annotations_.size())
         {
           break;
         }
@@ -282,7 +313,7 @@ void AnnotationManager::selectNext()
     }
 
     // Rotate at end of the indices
-    if (next_bbox_id >= this->annotation_bounding_boxes_.size())
+    if (next_bbox_id >= this->annotations_.size())
     {
       next_bbox_id = 0;
     }
@@ -291,15 +322,15 @@ void AnnotationManager::selectNext()
     this->select(next_bbox_id);
   }
   // If no bounding box is selected, select the first relevant one
-  else if (annotation_bounding_boxes_.size() > 0)
+  else if (!annotations_.isEmpty())
   {
     int next_bbox_id = -1;
 
     if (prefered_label_id_)
     {
-      for (int i = 0; i < annotation_bounding_boxes_.size(); i++)
+      for (int i = 0; i < annotations_.size(); i++)
       {
-        if (annotation_bounding_boxes_.at(i)->labelID() == prefered_label_id_.value())
+        if (annotations_.labelID(i) == prefered_label_id_.value())
         {
           next_bbox_id = i;
           break;
@@ -318,39 +349,53 @@ void AnnotationManager::selectNext()
 
 void AnnotationManager::unselect()
 {
-  for (const auto& bbox : annotation_bounding_boxes_)
+  for (AnnotationBoundingBox* item : items_)
   {
-    bbox->unselect();
+    item->unselect();
   }
 
   selected_bbox_id_.reset();
+
+  updateItems();
 }
 
-AnnotationBoundingBox* AnnotationManager::latest()
+QRectF AnnotationManager::boundingBoxRect(int bbox_index) const
 {
-  if (annotation_bounding_boxes_.empty())
+  if (bbox_index >= 0 && annotations_.size() > bbox_index)
   {
-    return nullptr;
+    return annotations_.rect(bbox_index);
   }
   else
   {
-    return annotation_bounding_boxes_.back();
+    return QRectF();
+  }
+}
+
+void AnnotationManager::setBoundingBoxRect(int bbox_index, const QRectF& rect)
+{
+  if (bbox_index >= 0 && annotations_.size() > bbox_index)
+  {
+    const QRectF previous_rect = annotations_.rect(bbox_index);
+
+    annotations_.setRect(bbox_index, rect);
+    bbox_grid_.update(bbox_index, annotations_.rect(bbox_index));
+    this->edited_ = true;
+
+    boundingBoxChanged(bbox_index, previous_rect);
   }
 }
 
 std::optional<std::pair<int, BoundingBoxPart>> AnnotationManager::getBoundingBoxPartUnderCursor(const QPointF& cursor_position)
 {
-  int bbox_id = 0;
-  for (AnnotationBoundingBox* bbox : annotation_bounding_boxes_)
+  // Only the boxes around the cursor are checked (in the same order as before => the first box still wins)
+  for (const int bbox_id : bbox_grid_.candidates(cursor_position))
   {
-    std::optional<BoundingBoxPart> part = bbox->getPart(cursor_position);
+    std::optional<BoundingBoxPart> part = annotations_.getPart(bbox_id, cursor_position);
 
     if (part)
     {
       return std::make_pair(bbox_id, *part);
     }
-
-    bbox_id++;
   }
 
   // Fallback
@@ -359,31 +404,51 @@ std::optional<std::pair<int, BoundingBoxPart>> AnnotationManager::getBoundingBox
 
 void AnnotationManager::removeLatest()
 {
-  if (annotation_bounding_boxes_.size() > 0)
+  if (!annotations_.isEmpty())
   {
-    image_view_->scene()->removeItem(annotation_bounding_boxes_.back());
-    annotation_bounding_boxes_.pop_back();
+    const int bbox_index = annotations_.size() - 1;
+
+    releaseItem(bbox_index);
+    bounding_boxes_item_->updateBoundingBox(annotations_.rect(bbox_index));
+
+    if (selected_bbox_id_ && selected_bbox_id_.value() == bbox_index)
+    {
+      selected_bbox_id_.reset();
+    }
+    if (hovered_bbox_id_ && hovered_bbox_id_.value() == bbox_index)
+    {
+      hovered_bbox_id_.reset();
+    }
+
+    annotations_.removeLast();
+    bbox_grid_.remove(annotations_.size());
+    this->edited_ = true;
   }
 }
 
 void AnnotationManager::remove(int bbox_index)
 {
-  if (annotation_bounding_boxes_.size() > bbox_index)
+  if (annotations_.size() > bbox_index)
   {
-    image_view_->scene()->removeItem(annotation_bounding_boxes_[bbox_index]);
-    annotation_bounding_boxes_.remove(bbox_index);
-  }
-}
+    // The items are stored by index => reassign all of them
+    releaseItems();
+    bounding_boxes_item_->updateBoundingBox(annotations_.rect(bbox_index));
 
-AnnotationBoundingBox* AnnotationManager::getAnnotationBoundingBox(int bbox_index)
-{
-  if (annotation_bounding_boxes_.size() > bbox_index)
-  {
-    return annotation_bounding_boxes_[bbox_index];
-  }
-  else
-  {
-    return nullptr;
+    annotations_.remove(bbox_index);
+    bbox_grid_.remove(bbox_index);
+    this->edited_ = true;
+
+    if (selected_bbox_id_ && selected_bbox_id_.value() > bbox_index)
+    {
+      selected_bbox_id_ = selected_bbox_id_.value() - 1;
+    }
+    else if (selected_bbox_id_ && selected_bbox_id_.value() == bbox_index)
+    {
+      selected_bbox_id_.reset();
+    }
+    hovered_bbox_id_.reset();
+
+    updateItems();
   }
 }
 
@@ -400,9 +465,11 @@ void AnnotationManager::removeSelectedBoundingBox()
 
 void AnnotationManager::activateLabel(const int label_id)
 {
-  if (selected_bbox_id_ && annotation_bounding_boxes_.size() > *selected_bbox_id_)
+  if (selected_bbox_id_ && annotations_.size() > *selected_bbox_id_)
   {
-    annotation_bounding_boxes_[*selected_bbox_id_]->setLabelID(label_id);
+    annotations_.setLabelID(*selected_bbox_id_, label_id);
+    this->edited_ = true;
+    boundingBoxChanged(*selected_bbox_id_, annotations_.rect(*selected_bbox_id_));
   }
 
   active_label_ = label_id;
@@ -412,3 +479,125 @@ int AnnotationManager::activeLabel() const
 {
   return active_label_;
 }
+
+void AnnotationManager::setHoveredBoundingBox(const std::optional<int> bbox_index)
+{
+  if (hovered_bbox_id_ == bbox_index)
+  {
+    return;
+  }
+
+  hovered_bbox_id_ = bbox_index;
+
+  updateItems();
+}
+
+void AnnotationManager::updateItems()
+{
+  QSet<int> shown_bbox_ids;
+
+  for (const std::optional<int>& bbox_index : {selected_bbox_id_, hovered_bbox_id_})
+  {
+    if (bbox_index && bbox_index.value() >= 0 && bbox_index.value() < annotations_.size())
+    {
+      shown_bbox_ids.insert(bbox_index.value());
+    }
+  }
+
+  for (const int bbox_index : items_.keys())
+  {
+    if (!shown_bbox_ids.contains(bbox_index))
+    {
+      releaseItem(bbox_index);
+    }
+  }
+
+  for (const int bbox_index : shown_bbox_ids)
+  {
+    acquireItem(bbox_index);
+  }
+}
+
+void AnnotationManager::boundingBoxChanged(int bbox_index, const QRectF& previous_rect)
+{
+  auto item = items_.find(bbox_index);
+
+  if (item != items_.end())
+  {
+    item.value()->assign(annotations_.rect(bbox_index), annotations_.labelID(bbox_index));
+  }
+  else
+  {
+    bounding_boxes_item_->updateBoundingBox(previous_rect.united(annotations_.rect(bbox_index)));
+  }
+}
+
+void AnnotationManager::showBoundingBoxesItem()
+{
+  if (!bounding_boxes_item_->scene())
+  {
+    image_view_->scene()->addItem(bounding_boxes_item_);
+  }
+}
+
+AnnotationBoundingBox* AnnotationManager::acquireItem(int bbox_index)
+{
+  auto item = items_.find(bbox_index);
+  if (item != items_.end())
+  {
+    return item.value();
+  }
+
+  AnnotationBoundingBox* new_item;
+  if (unused_items_.isEmpty())
+  {
+    new_item = new AnnotationBoundingBox(label_names_);
+  }
+  else
+  {
+    new_item = unused_items_.takeLast();
+  }
+
+  new_item->assign(annotations_.rect(bbox_index), annotations_.labelID(bbox_index));
+
+  if (selected_bbox_id_ && selected_bbox_id_.value() == bbox_index)
+  {
+    new_item->select();
+  }
+  else
+  {
+    new_item->unselect();
+  }
+
+  image_view_->scene()->addItem(new_item);
+  items_.insert(bbox_index, new_item);
+
+  bounding_boxes_item_->setHidden(bbox_index, true);
+
+  return new_item;
+}
+
+void AnnotationManager::releaseItem(int bbox_index)
+{
+  AnnotationBoundingBox* item = items_.take(bbox_index);
+
+  if (item)
+  {
+    if (item->scene())
+    {
+      item->scene()->removeItem(item);
+    }
+
+    unused_items_.push_back(item);
+
+    bounding_boxes_item_->setHidden(bbox_index, false);
+  }
+}
+
+void AnnotationManager::releaseItems()
+{
+  for (const int bbox_index : items_.keys())
+  {
+    releaseItem(bbox_index);
+  }
+}
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <QAbstractListModel>
+#include <QHash>
 
+#include "annotation_store.h"
 #include "annotationboundingbox.h"
+#include "bounding_box_grid.h"
+#include "bounding_boxes_item.h"
 #include "image_view.h"
 
 class ImageView;
@@ -19,6 +23,7 @@ public:
   };
 
   AnnotationManager(ImageView* image_view, const QStringList& label_names);
+  ~AnnotationManager();
 
   int rowCount(const QModelIndex& parent = QModelIndex()) const;
   int columnCount(const QModelIndex& parent = QModelIndex()) const;
@@ -36,7 +41,7 @@ public:
 
   void clear();
 
-  void add(AnnotationBoundingBox* new_bbox);
+  void add(const QRectF& rect, const int label_id);
   void select(int bbox_index);
   void unselect(int bbox_index);
   void unselect();
@@ -49,11 +54,14 @@ public:
 
   void removeSelectedBoundingBox();
 
-  AnnotationBoundingBox* latest();
+  QRectF boundingBoxRect(int bbox_index) const;
+  // Moves or resizes a bounding box (clipped to the image)
+  void setBoundingBoxRect(int bbox_index, const QRectF& rect);
 
   std::optional<std::pair<int, BoundingBoxPart>> getBoundingBoxPartUnderCursor(const QPointF& cursor_position);
 
-  AnnotationBoundingBox* getAnnotationBoundingBox(int bbox_index);
+  // Only the selected and the hovered box are shown by interactive graphics items
+  void setHoveredBoundingBox(const std::optional<int> bbox_index);
 
   void removeLatest();
   void remove(int bbox_index);
@@ -61,16 +69,45 @@ public:
   std::optional<int> prefered_label_id_;
 
 private:
-  QVector<AnnotationBoundingBox*> annotation_bounding_boxes_;
+  // Shows exactly the selected and the hovered box by interactive graphics items
+  void updateItems();
+
+  // Updates the item of the box or repaints it in the BoundingBoxesItem
+  void boundingBoxChanged(int bbox_index, const QRectF& previous_rect);
+
+  // Adds the BoundingBoxesItem to the scene if it was removed by clear()
+  void showBoundingBoxesItem();
+
+  AnnotationBoundingBox* acquireItem(int bbox_index);
+  void releaseItem(int bbox_index);
+  void releaseItems();
+
+  AnnotationStore annotations_;
+
+  // Spatial index of annotations_ for hit testing
+  BoundingBoxGrid bbox_grid_;
+
+  // Draws all boxes without an item
+  BoundingBoxesItem* bounding_boxes_item_;
+
+  // Graphics items of the selected and hovered boxes by their index
+  QHash<int, AnnotationBoundingBox*> items_;
+  // Items that are currently not part of the scene, to be reused for other boxes
+  QList<AnnotationBoundingBox*> unused_items_;
+
   ImageView* image_view_;
 
   QString output_label_filename_;
 
   std::optional<int> selected_bbox_id_;
+  std::optional<int> hovered_bbox_id_;
 
   int active_label_{0};
 
   bool cleared_{false};
+  // The label file had invalid lines / the boxes were changed since loading
+  bool load_errors_{false};
+  bool edited_{false};
 
   const QStringList& label_names_;
 };
@@ -0,0 +1,214 @@
+#include <cmath>
+#include <limits>
+
+#include "annotation_store.h"
+
+namespace
+{
+float squaredDistance(const QPointF& p1, const QPointF& p2)
+{
+  const QPointF diff = p1 - p2;
+  return QPointF::dotProduct(diff, diff);
+}
+} // namespace
+
+void AnnotationStore::setImageSize(const QSize& image_size)
+{
+  image_size_ = image_size;
+}
+
+QSize AnnotationStore::imageSize() const
+{
+  return image_size_;
+}
+
+int AnnotationStore::size() const
+{
+  return label_ids_.size();
+}
+
+bool AnnotationStore::isEmpty() const
+{
+  return label_ids_.isEmpty();
+}
+
+void AnnotationStore::reserve(const int size)
+{
+  label_ids_.reserve(size);
+  x_mins_.reserve(size);
+  y_mins_.reserve(size);
+  widths_.reserve(size);
+  heights_.reserve(size);
+}
+
+void AnnotationStore::clear()
+{
+  label_ids_.clear();
+  x_mins_.clear();
+  y_mins_.clear();
+  widths_.clear();
+  heights_.clear();
+}
+
+int AnnotationStore::append(const int label_id, const QRectF& rect)
+{
+  label_ids_.push_back(label_id);
+  x_mins_.push_back(0.f);
+  y_mins_.push_back(0.f);
+  widths_.push_back(0.f);
+  heights_.push_back(0.f);
+
+  const int index = label_ids_.size() - 1;
+  setRect(index, rect);
+
+  return index;
+}
+
+void AnnotationStore::remove(const int index)
+{
+  label_ids_.remove(index);
+  x_mins_.remove(index);
+  y_mins_.remove(index);
+  widths_.remove(index);
+  heights_.remove(index);
+}
+
+void AnnotationStore::removeLast()
+{
+  label_ids_.pop_back();
+  x_mins_.pop_back();
+  y_mins_.pop_back();
+  widths_.pop_back();
+  heights_.pop_back();
+}
+
+int AnnotationStore::labelID(const int index) const
+{
+  return label_ids_.at(index);
+}
+
+void AnnotationStore::setLabelID(const int index, const int label_id)
+{
+  label_ids_[index] = label_id;
+}
+
+QRectF AnnotationStore::rect(const int index) const
+{
+  return QRectF(x_mins_.at(index), y_mins_.at(index), widths_.at(index), heights_.at(index));
+}
+
+void AnnotationStore::setRect(const int index, const QRectF& rect)
+{
+  const QRectF clipped_rect = rect.intersected(QRectF(QPointF(0, 0), image_size_));
+
+  x_mins_[index] = clipped_rect.x();
+  y_mins_[index] = clipped_rect.y();
+  widths_[index] = clipped_rect.width();
+  heights_[index] = clipped_rect.height();
+}
+
+std::optional<BoundingBoxPart> AnnotationStore::getPart(const int index, const QPointF& cursor_position) const
+{
+  const float catch_radius = 20.0;
+
+  // All distances are compared squared (no sqrt needed)
+  const float squared_catch_radius = catch_radius * catch_radius;
+
+  const QRectF bbox_rect = rect(index);
+
+  float current_best_dist = std::numeric_limits<float>::infinity();
+  std::optional<BoundingBoxPart> current_best_part;
+
+  float dist;
+
+  if (cursor_position.x() >= bbox_rect.left() && cursor_position.y() >= bbox_rect.top() &&
+      cursor_position.x() <= bbox_rect.right() && cursor_position.y() <= bbox_rect.bottom())
+  {
+    current_best_part = BoundingBoxPart::CentralArea;
+    current_best_dist = 0.f;
+  }
+
+  dist = squaredDistance(bbox_rect.topLeft(), cursor_position);
+  if (dist < squared_catch_radius && dist < current_best_dist)
+  {
+    current_best_part = BoundingBoxPart::CornerUpperLeft;
+    current_best_dist = dist;
+  }
+
+  dist = squaredDistance(bbox_rect.topRight(), cursor_position);
+  if (dist < squared_catch_radius && dist < current_best_dist)
+  {
+    current_best_part = BoundingBoxPart::CornerUpperRight;
+    current_best_dist = dist;
+  }
+
+  dist = squaredDistance(bbox_rect.bottomLeft(), cursor_position);
+  if (dist < squared_catch_radius && dist < current_best_dist)
+  {
+    current_best_part = BoundingBoxPart::CornerLowerLeft;
+    current_best_dist = dist;
+  }
+
+  dist = squaredDistance(bbox_rect.bottomRight(), cursor_position);
+  if (dist < squared_catch_radius && dist < current_best_dist)
+  {
+    current_best_part = BoundingBoxPart::CornerLowerRight;
+    current_best_dist = dist;
+  }
+
+  dist = squaredDistance((bbox_rect.topLeft() + bbox_rect.bottomLeft()) / 2., cursor_position);
+  if (std::abs(bbox_rect.left() - cursor_position.x()) < catch_radius / 2. && cursor_position.y() >= bbox_rect.top() &&
+      cursor_position.y() <= bbox_rect.bottom() && dist < current_best_dist)
+  {
+    current_best_part = BoundingBoxPart::EdgeLeft;
+    current_best_dist = dist;
+  }
+
+  dist = squaredDistance((bbox_rect.topRight() + bbox_rect.bottomRight()) / 2., cursor_position);
+  if (std::abs(bbox_rect.right() - cursor_position.x()) < catch_radius / 2. && cursor_position.y() >= bbox_rect.top() &&
+      cursor_position.y() <= bbox_rect.bottom() && dist < current_best_dist)
+  {
+    current_best_part = BoundingBoxPart::EdgeRight;
+    current_best_dist = dist;
+  }
+
+  dist = squaredDistance((bbox_rect.topLeft() + bbox_rect.topRight()) / 2., cursor_position);
+  if (std::abs(bbox_rect.top() - cursor_position.y()) < catch_radius / 2. && cursor_position.x() >= bbox_rect.left() &&
+      cursor_position.x() <= bbox_rect.right() && dist < current_best_dist)
+  {
+    current_best_part = BoundingBoxPart::EdgeTop;
+    current_best_dist = dist;
+  }
+
+  dist = squaredDistance((bbox_rect.bottomLeft() + bbox_rect.bottomRight()) / 2., cursor_position);
+  if (std::abs(bbox_rect.bottom() - cursor_position.y()) < catch_radius / 2. && cursor_position.x() >= bbox_rect.left() &&
+      cursor_position.x() <= bbox_rect.right() && dist < current_best_dist)
+  {
+    current_best_part = BoundingBoxPart::EdgeBottom;
+  }
+
+  return current_best_part;
+}
+
+QString AnnotationStore::toString(const int index) const
+{
+  const QPointF center = rect(index).center();
+
+  return QString("%1 %2 %3 %4 %5")
+      .arg(label_ids_.at(index))
+      .arg(center.x() / float(image_size_.width()))
+      .arg(center.y() / float(image_size_.height()))
+      .arg(widths_.at(index) / float(image_size_.width()))
+      .arg(heights_.at(index) / float(image_size_.height()));
+}
+
+QRectF AnnotationStore::rectFromYolo(
+    const float x_center, const float y_center, const float width, const float height, const QSize& image_size)
+{
+  const float box_x_center = x_center * image_size.width();
+  const float box_y_center = y_center * image_size.height();
+  const float box_width = width * image_size.width();
+  const float box_height = height * image_size.height();
+
+  return QRectF(QPointF(box_x_center - box_width / 2.f, box_y_center - box_height / 2.f), QSizeF(box_width, box_height));
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QList>
+#include <QPointF>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+
+#include <optional>
+
+enum class BoundingBoxPart
+{
+  CentralArea,
+  CornerUpperLeft,
+  CornerUpperRight,
+  CornerLowerRight,
+  CornerLowerLeft,
+  EdgeLeft,
+  EdgeRight,
+  EdgeTop,
+  EdgeBottom,
+};
+
+// All bounding boxes of one image as structure of arrays (in pixel coordinates of the image).
+// Graphics items are only created on top of it for the boxes that are shown (see AnnotationManager).
+class AnnotationStore
+{
+public:
+  void setImageSize(const QSize& image_size);
+  QSize imageSize() const;
+
+  int size() const;
+  bool isEmpty() const;
+
+  void reserve(const int size);
+  void clear();
+
+  // The rect is clipped to the image, returns the index of the new box
+  int append(const int label_id, const QRectF& rect);
+
+  void remove(const int index);
+  void removeLast();
+
+  int labelID(const int index) const;
+  void setLabelID(const int index, const int label_id);
+
+  QRectF rect(const int index) const;
+  // The rect is clipped to the image
+  void setRect(const int index, const QRectF& rect);
+
+  std::optional<BoundingBoxPart> getPart(const int index, const QPointF& cursor_position) const;
+
+  // One line of a YOLO label file
+  QString toString(const int index) const;
+
+  // Converts the relative YOLO coordinates into a rect in pixels of the image
+  static QRectF rectFromYolo(const float x_center, const float y_center, const float width, const float height, const QSize& image_size);
+
+private:
+  QSize image_size_;
+
+  QList<int> label_ids_;
+  QList<float> x_mins_;
+  QList<float> y_mins_;
+  QList<float> widths_;
+  QList<float> heights_;
+};
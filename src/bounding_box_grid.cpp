@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cmath>
+
+#include "bounding_box_grid.h"
+
+BoundingBoxGrid::BoundingBoxGrid(const float cell_size, const float margin)
+    : cell_size_(cell_size),
+      margin_(margin)
+{
+}
+
+void BoundingBoxGrid::append(const QRectF& rect)
+{
+  const QRect cell_range = cellRange(rect);
+
+  insertIntoCells(cell_ranges_.size(), cell_range);
+  cell_ranges_.push_back(cell_range);
+}
+
+void BoundingBoxGrid::update(const int index, const QRectF& rect)
+{
+  if (index < 0 || index >= cell_ranges_.size())
+  {
+    return;
+  }
+
+  const QRect cell_range = cellRange(rect);
+
+  // Most moves stay within the same cells
+  if (cell_range == cell_ranges_[index])
+  {
+    return;
+  }
+
+  removeFromCells(index, cell_ranges_[index]);
+  insertIntoCells(index, cell_range);
+  cell_ranges_[index] = cell_range;
+}
+
+void BoundingBoxGrid::remove(const int index)
+{
+  if (index < 0 || index >= cell_ranges_.size())
+  {
+    return;
+  }
+
+  removeFromCells(index, cell_ranges_[index]);
+  cell_ranges_.remove(index);
+
+  for (QList<int>& cell : cells_)
+  {
+    for (int& cell_index : cell)
+    {
+      if (cell_index > index)
+      {
+        cell_index--;
+      }
+    }
+  }
+}
+
+void BoundingBoxGrid::clear()
+{
+  cells_.clear();
+  cell_ranges_.clear();
+}
+
+void BoundingBoxGrid::clear(const float cell_size)
+{
+  cell_size_ = cell_size;
+
+  clear();
+}
+
+QList<int> BoundingBoxGrid::candidates(const QPointF& position) const
+{
+  QList<int> indices = cells_.value(cellKey(std::floor(position.x() / cell_size_), std::floor(position.y() / cell_size_)));
+
+  std::sort(indices.begin(), indices.end());
+
+  return indices;
+}
+
+QList<int> BoundingBoxGrid::candidates(const QRectF& rect) const
+{
+  const QRect query_cell_range = cellRange(rect);
+
+  // Cheaper than collecting (and deduplicating) the boxes of all cells of a large rect
+  QList<int> indices;
+  for (int index = 0; index < cell_ranges_.size(); index++)
+  {
+    if (cell_ranges_[index].intersects(query_cell_range))
+    {
+      indices.push_back(index);
+    }
+  }
+
+  return indices;
+}
+
+QRect BoundingBoxGrid::cellRange(const QRectF& rect) const
+{
+  const QRectF expanded_rect = rect.adjusted(-margin_, -margin_, margin_, margin_);
+
+  return QRect(QPoint(std::floor(expanded_rect.left() / cell_size_), std::floor(expanded_rect.top() / cell_size_)),
+               QPoint(std::floor(expanded_rect.right() / cell_size_), std::floor(expanded_rect.bottom() / cell_size_)));
+}
+
+qint64 BoundingBoxGrid::cellKey(const int cell_x, const int cell_y)
+{
+  return (qint64(cell_x) << 32) | quint32(cell_y);
+}
+
+void BoundingBoxGrid::insertIntoCells(const int index, const QRect& cell_range)
+{
+  for (int cell_y = cell_range.top(); cell_y <= cell_range.bottom(); cell_y++)
+  {
+    for (int cell_x = cell_range.left(); cell_x <= cell_range.right(); cell_x++)
+    {
+      cells_[cellKey(cell_x, cell_y)].push_back(index);
+    }
+  }
+}
+
+void BoundingBoxGrid::removeFromCells(const int index, const QRect& cell_range)
+{
+  for (int cell_y = cell_range.top(); cell_y <= cell_range.bottom(); cell_y++)
+  {
+    for (int cell_x = cell_range.left(); cell_x <= cell_range.right(); cell_x++)
+    {
+      const qint64 key = cellKey(cell_x, cell_y);
+
+      auto cell = cells_.find(key);
+      if (cell == cells_.end())
+      {
+        continue;
+      }
+
+      cell->removeOne(index);
+
+      if (cell->isEmpty())
+      {
+        cells_.erase(cell);
+      }
+    }
+  }
+}
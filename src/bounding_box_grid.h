@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QPointF>
+#include <QRect>
+#include <QRectF>
+
+// Uniform grid over the image that maps every cell to the indices of the bounding boxes that touch it,
+// so that hit testing only has to look at the boxes around the cursor.
+// The indices are the ones of AnnotationManager and have to be kept in sync with it.
+class BoundingBoxGrid
+{
+public:
+  // Boxes are registered in all cells within margin of them (e.g. the catch radius of their corners)
+  explicit BoundingBoxGrid(const float cell_size = 64.f, const float margin = 20.f);
+
+  // Appends a box with the next index
+  void append(const QRectF& rect);
+
+  void update(const int index, const QRectF& rect);
+
+  // The indices of all following boxes are decreased by one
+  void remove(const int index);
+
+  void clear();
+
+  // Also sets a new cell size (e.g. for the size of the next image)
+  void clear(const float cell_size);
+
+  // Indices of all boxes that can contain the position (in ascending order)
+  QList<int> candidates(const QPointF& position) const;
+
+  // Indices of all boxes that can intersect the rect (in ascending order)
+  QList<int> candidates(const QRectF& rect) const;
+
+private:
+  // Range of cells covered by the rect (incl. the margin)
+  QRect cellRange(const QRectF& rect) const;
+
+  static qint64 cellKey(const int cell_x, const int cell_y);
+
+  void insertIntoCells(const int index, const QRect& cell_range);
+  void removeFromCells(const int index, const QRect& cell_range);
+
+  float cell_size_;
+  const float margin_;
+
+  QHash<qint64, QList<int>> cells_;
+
+  // Covered cells of each box
+  QList<QRect> cell_ranges_;
+};
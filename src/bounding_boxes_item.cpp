@@ -0,0 +1,153 @@
+#include <algorithm>
+
+#include <QFontMetricsF>
+#include <QGraphicsScene>
+#include <QGraphicsView>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include "annotationboundingbox.h"
+#include "bounding_boxes_item.h"
+#include "label_colors.h"
+
+namespace
+{
+// Same as the pen of AnnotationBoundingBox
+const int pen_width = 5;
+} // namespace
+
+BoundingBoxesItem::BoundingBoxesItem(const AnnotationStore& annotations,
+                                     const BoundingBoxGrid& bbox_grid,
+                                     const QStringList& label_names)
+    : annotations_(annotations),
+      bbox_grid_(bbox_grid),
+      label_names_(label_names)
+{
+  // Needed to get the exposed rect in paint()
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+
+  // Hit testing is done by the AnnotationManager
+  setAcceptedMouseButtons(Qt::NoButton);
+
+  this->setZValue(100);
+
+  const QFontMetricsF font_metrics(AnnotationBoundingBox::labelTextFont());
+
+  qreal max_text_width = 0;
+  for (const QString& label_name : label_names_)
+  {
+    max_text_width = std::max(max_text_width, font_metrics.horizontalAdvance(label_name));
+  }
+
+  label_text_margins_ = QMarginsF(0, font_metrics.ascent(), max_text_width, font_metrics.descent());
+}
+
+void BoundingBoxesItem::reset()
+{
+  prepareGeometryChange();
+
+  update();
+}
+
+void BoundingBoxesItem::updateBoundingBox(const QRectF& rect)
+{
+  // The pen is cosmetic => its width in scene coordinates depends on the zoom
+  qreal pen_margin = pen_width;
+  if (scene() && !scene()->views().isEmpty() && scene()->views().first()->transform().m11() > 0)
+  {
+    pen_margin /= scene()->views().first()->transform().m11();
+  }
+
+  update(rect.marginsAdded(label_text_margins_).adjusted(-pen_margin, -pen_margin, pen_margin, pen_margin));
+}
+
+void BoundingBoxesItem::setHidden(const int bbox_index, const bool hidden)
+{
+  if (hidden == hidden_bbox_ids_.contains(bbox_index))
+  {
+    return;
+  }
+
+  if (hidden)
+  {
+    hidden_bbox_ids_.insert(bbox_index);
+  }
+  else
+  {
+    hidden_bbox_ids_.remove(bbox_index);
+  }
+
+  if (bbox_index >= 0 && bbox_index < annotations_.size())
+  {
+    updateBoundingBox(annotations_.rect(bbox_index));
+  }
+}
+
+QRectF BoundingBoxesItem::boundingRect() const
+{
+  return QRectF(QPointF(0, 0), annotations_.imageSize()).marginsAdded(label_text_margins_);
+}
+
+void BoundingBoxesItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+  // A box can reach into the exposed rect by its label text
+  const QRectF query_rect = option->exposedRect.marginsAdded(QMarginsF(
+      label_text_margins_.right(), label_text_margins_.bottom(), label_text_margins_.left(), label_text_margins_.top()));
+
+  // The boxes are grouped by label => one pen (and one draw call) per label
+  QHash<int, QList<QRectF>> rects_by_label_id;
+
+  for (const int bbox_index : bbox_grid_.candidates(query_rect))
+  {
+    if (!hidden_bbox_ids_.contains(bbox_index))
+    {
+      rects_by_label_id[annotations_.labelID(bbox_index)].push_back(annotations_.rect(bbox_index));
+    }
+  }
+
+  QPen pen;
+  pen.setWidth(pen_width);
+  pen.setCosmetic(true);
+
+  painter->setBrush(Qt::NoBrush);
+
+  for (auto rects = rects_by_label_id.cbegin(); rects != rects_by_label_id.cend(); rects++)
+  {
+    QColor color = LabelColors::colorForLabelId(rects.key());
+
+    pen.setColor(color);
+    painter->setPen(pen);
+    painter->drawRects(rects.value().constData(), rects.value().size());
+
+    if (label_names_.size() > rects.key() && rects.key() >= 0)
+    {
+      color.setAlphaF(0.7);
+      painter->setPen(color);
+      painter->setFont(AnnotationBoundingBox::labelTextFont());
+
+      const QStaticText& label_text = labelText(rects.key());
+
+      // drawText() of AnnotationBoundingBox uses the top left corner as baseline
+      for (const QRectF& rect : rects.value())
+      {
+        painter->drawStaticText(rect.topLeft() - QPointF(0, label_text_margins_.top()), label_text);
+      }
+    }
+  }
+}
+
+const QStaticText& BoundingBoxesItem::labelText(const int label_id)
+{
+  auto label_text = label_texts_.find(label_id);
+
+  if (label_text == label_texts_.end())
+  {
+    QStaticText new_label_text(label_names_.at(label_id));
+    new_label_text.setTextFormat(Qt::PlainText);
+    new_label_text.setPerformanceHint(QStaticText::AggressiveCaching);
+
+    label_text = label_texts_.insert(label_id, new_label_text);
+  }
+
+  return label_text.value();
+}
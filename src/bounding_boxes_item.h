@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QMarginsF>
+#include <QSet>
+#include <QStaticText>
+
+#include "annotation_store.h"
+#include "bounding_box_grid.h"
+
+// Draws all bounding boxes of the AnnotationStore in a single pass, except the hidden ones
+// (the selected / hovered boxes are shown by interactive AnnotationBoundingBox items instead).
+// Only the boxes within the exposed rect are drawn, the label names are drawn as cached static texts.
+class BoundingBoxesItem : public QGraphicsItem
+{
+public:
+  BoundingBoxesItem(const AnnotationStore& annotations, const BoundingBoxGrid& bbox_grid, const QStringList& label_names);
+
+  // Has to be called after the boxes or the image size were replaced
+  void reset();
+
+  // Repaints the area of a changed box (rect incl. the label text)
+  void updateBoundingBox(const QRectF& rect);
+
+  void setHidden(const int bbox_index, const bool hidden);
+
+  QRectF boundingRect() const override;
+  void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+private:
+  const QStaticText& labelText(const int label_id);
+
+  const AnnotationStore& annotations_;
+  const BoundingBoxGrid& bbox_grid_;
+  const QStringList& label_names_;
+
+  // Area around a box that can be covered by its label text
+  QMarginsF label_text_margins_;
+
+  QSet<int> hidden_bbox_ids_;
+
+  // By label id
+  QHash<int, QStaticText> label_texts_;
+};
@@ -1,5 +1,5 @@
+#include <QDeadlineTimer>
 #include <QDebug>
-#include <QElapsedTimer>
 #include <QImage>
 #include <QString>
 
@@ -7,87 +7,223 @@
 
 using namespace sqlite_orm;
 
-CacheDBConnection::CacheDBConnection(const QDir& root_path)
+CacheDBConnection::CacheDBConnection(const QDir& root_path,
+                                     const PreviewCacheBackend backend,
+                                     const qsizetype preview_cache_budget)
+    : preview_image_cache_(preview_cache_budget)
 {
-  storage_ =
-      std::make_unique<StorageType>(make_storage(root_path.absoluteFilePath("cache.sqlite").toStdString(),
-                                                 make_table("preview_images",
-                                                            make_column("id", &DBPreviewImage::id, primary_key().autoincrement()),
-                                                            make_column("md5_hash", &DBPreviewImage::md5_hash),
-                                                            make_column("filesize", &DBPreviewImage::filesize),
-                                                            make_column("preview_image", &DBPreviewImage::preview_image),
-                                                            make_column("preview_width", &DBPreviewImage::preview_width),
-                                                            make_column("preview_height", &DBPreviewImage::preview_height))));
+  const std::string db_filename = root_path.absoluteFilePath("cache.sqlite").toStdString();
+
+  if (backend == PreviewCacheBackend::ATLAS)
+  {
+    atlas_ = std::make_unique<PreviewAtlas>(root_path);
+
+    writer_thread_ = QThread::create([this, db_filename]() { writeQueuedPreviewImages(db_filename); });
+    writer_thread_->start();
+    return;
+  }
+
+  storage_ = std::make_unique<StorageType>(makeCacheStorage(db_filename));
+
+  // Databases from before the unique index on (md5_hash, filesize) can contain duplicates, which would prevent it.
+  // This scans the whole table, so it is only done once (user_version 0 -> 1) and not on every start.
+  const int schema_version = 1;
+
+  if (storage_->pragma.user_version() < schema_version && storage_->table_exists("preview_images"))
+  {
+    storage_->remove_all<DBPreviewImage>(where(not_in(
+        &DBPreviewImage::id, select(min(&DBPreviewImage::id), group_by(&DBPreviewImage::md5_hash, &DBPreviewImage::filesize)))));
+  }
 
   storage_->sync_schema(false);
 
-  QElapsedTimer timer;
-  timer.start();
+  storage_->pragma.user_version(schema_version);
+
+  storage_->open_forever();
+
+  // WAL: The writer thread does not block the lookups and commits do not need to sync the whole database
+  storage_->pragma.journal_mode(journal_mode::WAL);
+  storage_->pragma.synchronous(1); // NORMAL
+
+  // A prepared statement needs an open connection
+  preview_image_lookup_ = std::make_unique<PreviewImageLookupType>(preparePreviewImageLookup(*storage_));
 
-  auto all_db_preview_images = storage_->get_all<DBPreviewImage>();
-  for (const DBPreviewImage& db_image : all_db_preview_images)
+  writer_thread_ = QThread::create([this, db_filename]() { writeQueuedPreviewImages(db_filename); });
+  writer_thread_->start();
+}
+
+CacheDBConnection::~CacheDBConnection()
+{
   {
-    preview_image_cache_.insert(
-        QString::fromStdString(db_image.md5_hash),
-        QImage((uchar*)db_image.preview_image.data(), db_image.preview_width, db_image.preview_height, QImage::Format_RGB888)
-            .copy());
+    QMutexLocker locker(&writer_mutex_);
+    stop_writer_ = true;
+    writer_condition_.wakeAll();
   }
 
-  qDebug() << "Loading " << all_db_preview_images.size() << " preview images from the SQLite Database took " << timer.elapsed()
-           << "ms";
+  // Flushes the remaining previews
+  writer_thread_->wait();
+  delete writer_thread_;
+}
+
+void CacheDBConnection::setPreviewCacheBudget(const qsizetype preview_cache_budget)
+{
+  preview_image_cache_.setMaxCost(preview_cache_budget);
+}
+
+void CacheDBConnection::setPreviewCodec(const PreviewCodec codec)
+{
+  QMutexLocker locker(&writer_mutex_);
+  preview_codec_ = codec;
 }
 
 void CacheDBConnection::storePreviewImage(const QString& md5_hash, const int filesize, const QImage& image)
 {
-  // TODO: Also check filesize!
+  cachePreviewImage(md5_hash, filesize, image);
 
-  // auto existing_elements =
-  // storage_->get_all<DBPreviewImage>(sqlite_orm::where(sqlite_orm::c(&DBPreviewImage::md5_hash) == md5_hash.toStdString()));
+  QMutexLocker locker(&writer_mutex_);
+  queued_preview_images_.push_back(QueuedPreviewImage{md5_hash, filesize, image});
+  writer_condition_.wakeAll();
+}
 
-  // qDebug() << "found " << existing_elements.size() << " with hash=" << md5_hash;
+void CacheDBConnection::cachePreviewImage(const QString& md5_hash, const int filesize, const QImage& image)
+{
+  preview_image_cache_.insert(cacheKey(md5_hash, filesize), new QImage(image), image.sizeInBytes());
+}
 
-  DBPreviewImage db_image;
-  db_image.filesize = filesize;
-  db_image.md5_hash = md5_hash.toStdString();
+bool CacheDBConnection::takeQueuedPreviewImages(QList<QueuedPreviewImage>& preview_images, PreviewCodec& codec)
+{
+  // Collect previews for a moment, so that one batch covers many of them
+  const int max_batch_delay_ms = 100;
+  const int min_batch_size = 256;
 
-  db_image.preview_image.resize(image.sizeInBytes());
-  std::memcpy(db_image.preview_image.data(), (const char*)image.constBits(), image.sizeInBytes());
+  QMutexLocker locker(&writer_mutex_);
 
-  // db_image.preview_image = std::vector<char>(char(255), image.sizeInBytes());
+  while (queued_preview_images_.isEmpty() && !stop_writer_)
+  {
+    writer_condition_.wait(&writer_mutex_);
+  }
 
-  db_image.preview_width = image.width();
-  db_image.preview_height = image.height();
+  // Every storePreviewImage() wakes this thread up => keep waiting until the batch is full or the delay is over
+  const QDeadlineTimer deadline(max_batch_delay_ms);
 
-  auto insertedId = storage_->insert(db_image);
-  qDebug() << "inserted image with id=" << insertedId << ", hash=" << md5_hash << ", bytes=" << image.sizeInBytes()
-           << ", image_size=" << image.width() << "x" << image.height();
+  while (queued_preview_images_.size() < min_batch_size && !stop_writer_ && !deadline.hasExpired())
+  {
+    writer_condition_.wait(&writer_mutex_, deadline);
+  }
+
+  if (queued_preview_images_.isEmpty() && stop_writer_)
+  {
+    return false;
+  }
+
+  preview_images.swap(queued_preview_images_);
+  codec = preview_codec_;
+
+  return true;
 }
 
-std::optional<QImage> CacheDBConnection::getPreviewImage(const QString& md5_hash, const int filesize) const
+void CacheDBConnection::writeQueuedPreviewImages(const std::string& db_filename)
 {
-  if (preview_image_cache_.contains(md5_hash))
+  QList<QueuedPreviewImage> preview_images;
+  PreviewCodec codec = PreviewCodec::RAW_RGB888;
+
+  if (atlas_)
   {
-    return preview_image_cache_[md5_hash];
+    while (takeQueuedPreviewImages(preview_images, codec))
+    {
+      for (const QueuedPreviewImage& preview_image : preview_images)
+      {
+        atlas_->store(preview_image.md5_hash, preview_image.filesize, preview_image.image);
+      }
+      preview_images.clear();
+    }
+    return;
   }
 
-  // TODO: Also check filesize!
-  auto existing_elements =
-      storage_->get_all<DBPreviewImage>(sqlite_orm::where(sqlite_orm::c(&DBPreviewImage::md5_hash) == md5_hash.toStdString()));
+  // Own connection, batches are written in one transaction each
+  StorageType storage = makeCacheStorage(db_filename);
+  storage.open_forever();
+  storage.busy_timeout(5000);
+  storage.pragma.synchronous(1); // NORMAL
+
+  while (takeQueuedPreviewImages(preview_images, codec))
+  {
+    // Encode outside of the transaction, so the database is locked as short as possible
+    std::vector<EncodedPreviewImage> encoded_images;
+    encoded_images.reserve(preview_images.size());
+    for (const QueuedPreviewImage& preview_image : preview_images)
+    {
+      encoded_images.push_back(PreviewImageCodec::encode(preview_image.image, codec));
+    }
+
+    storage.transaction(
+        [&]()
+        {
+          for (int i = 0; i < preview_images.size(); i++)
+          {
+            const EncodedPreviewImage& encoded_image = encoded_images[i];
+
+            // Replaces an existing preview with the same (md5_hash, filesize)
+            storage.replace(into<DBPreviewImage>(),
+                            columns(&DBPreviewImage::md5_hash,
+                                    &DBPreviewImage::filesize,
+                                    &DBPreviewImage::preview_image,
+                                    &DBPreviewImage::preview_width,
+                                    &DBPreviewImage::preview_height,
+                                    &DBPreviewImage::codec),
+                            values(std::make_tuple(preview_images[i].md5_hash.toStdString(),
+                                                   preview_images[i].filesize,
+                                                   encoded_image.data,
+                                                   encoded_image.width,
+                                                   encoded_image.height,
+                                                   int(encoded_image.codec))));
+          }
+          return true;
+        });
+
+    preview_images.clear();
+  }
+}
 
-  // qDebug() << "found " << existing_elements.size() << " with hash=" << md5_hash;
+std::optional<QImage> CacheDBConnection::getCachedPreviewImage(const QString& md5_hash, const int filesize) const
+{
+  if (const QImage* cached_image = preview_image_cache_.object(cacheKey(md5_hash, filesize)))
+  {
+    return *cached_image;
+  }
 
-  if (existing_elements.size() > 0)
+  if (atlas_)
   {
-    const DBPreviewImage& db_image = existing_elements[0];
-    // qDebug() << "db_image.preview_image.size()=" << db_image.preview_image.size();
+    return atlas_->get(md5_hash, filesize);
+  }
+
+  return {};
+}
+
+std::optional<EncodedPreviewImage> CacheDBConnection::getEncodedPreviewImage(const QString& md5_hash, const int filesize) const
+{
+  if (atlas_)
+  {
+    return {};
+  }
+
+  get<0>(*preview_image_lookup_) = md5_hash.toStdString();
+  get<1>(*preview_image_lookup_) = filesize;
 
-    QImage output_image =
-        QImage((uchar*)db_image.preview_image.data(), db_image.preview_width, db_image.preview_height, QImage::Format_RGB888);
+  auto existing_elements = storage_->execute(*preview_image_lookup_);
 
-    preview_image_cache_.insert(md5_hash, output_image.copy());
+  if (existing_elements.size() > 0)
+  {
+    DBPreviewImage& db_image = existing_elements[0];
 
-    return preview_image_cache_[md5_hash];
+    return EncodedPreviewImage{
+        PreviewCodec(db_image.codec), db_image.preview_width, db_image.preview_height, std::move(db_image.preview_image)};
   }
 
   return {};
 }
+
+QString CacheDBConnection::cacheKey(const QString& md5_hash, const int filesize)
+{
+  return md5_hash + ":" + QString::number(filesize);
+}
@@ -2,9 +2,16 @@
 
 #include <QCache>
 #include <QDir>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
 
 #include <string>
 
+#include "preview_atlas.h"
+#include "preview_image_codec.h"
 #include "sqlite_orm.h"
 
 struct DBPreviewImage
@@ -15,29 +22,103 @@ struct DBPreviewImage
   std::vector<char> preview_image;
   int preview_width;
   int preview_height;
+  int codec; // PreviewCodec
+};
+
+inline auto makeCacheStorage(const std::string& filename)
+{
+  using namespace sqlite_orm;
+  return make_storage(
+      filename,
+      make_unique_index("preview_images_md5_hash_filesize", &DBPreviewImage::md5_hash, &DBPreviewImage::filesize),
+      make_table("preview_images",
+                 make_column("id", &DBPreviewImage::id, primary_key().autoincrement()),
+                 make_column("md5_hash", &DBPreviewImage::md5_hash),
+                 make_column("filesize", &DBPreviewImage::filesize),
+                 make_column("preview_image", &DBPreviewImage::preview_image),
+                 make_column("preview_width", &DBPreviewImage::preview_width),
+                 make_column("preview_height", &DBPreviewImage::preview_height),
+                 // Rows of older databases are raw RGB888
+                 make_column("codec", &DBPreviewImage::codec, default_value(int(PreviewCodec::RAW_RGB888)))));
+}
+
+using CacheStorageType = decltype(makeCacheStorage(""));
+
+// Lookup of a preview by (md5_hash, filesize), which is answered by the unique index
+inline auto preparePreviewImageLookup(CacheStorageType& storage)
+{
+  using namespace sqlite_orm;
+  return storage.prepare(get_all<DBPreviewImage>(
+      where(c(&DBPreviewImage::md5_hash) == std::string() and c(&DBPreviewImage::filesize) == 0), limit(1)));
+}
+
+// Where the preview images are stored on disk
+enum class PreviewCacheBackend
+{
+  SQLITE, // preview_images table of cache.sqlite
+  ATLAS,  // Memory mapped PreviewAtlas, previews are read without copying or decoding them
 };
 
 class CacheDBConnection
 {
 public:
-  CacheDBConnection(const QDir& root_path);
+  CacheDBConnection(const QDir& root_path,
+                    const PreviewCacheBackend backend = PreviewCacheBackend::SQLITE,
+                    const qsizetype preview_cache_budget = 128 * 1024 * 1024);
+  ~CacheDBConnection();
+
+  // Max. number of bytes of the preview images kept in memory
+  void setPreviewCacheBudget(const qsizetype preview_cache_budget);
 
+  // Codec used for all previews written from now on (only used by the SQLITE backend)
+  void setPreviewCodec(const PreviewCodec codec);
+
+  // The preview is available immediately, it is encoded and written to the database in the background
   void storePreviewImage(const QString& md5_hash, const int filesize, const QImage& image);
-  std::optional<QImage> getPreviewImage(const QString& md5_hash, const int filesize) const;
-
-  using StorageType = sqlite_orm::internal::storage_t<sqlite_orm::internal::table_t<
-      DBPreviewImage,
-      false,
-      sqlite_orm::internal::column_t<int DBPreviewImage::*,
-                                     sqlite_orm::internal::empty_setter,
-                                     sqlite_orm::internal::primary_key_with_autoincrement<sqlite_orm::internal::primary_key_t<>>>,
-      sqlite_orm::internal::column_t<std::string DBPreviewImage::*, sqlite_orm::internal::empty_setter>,
-      sqlite_orm::internal::column_t<int DBPreviewImage::*, sqlite_orm::internal::empty_setter>,
-      sqlite_orm::internal::column_t<std::vector<char> DBPreviewImage::*, sqlite_orm::internal::empty_setter>,
-      sqlite_orm::internal::column_t<int DBPreviewImage::*, sqlite_orm::internal::empty_setter>,
-      sqlite_orm::internal::column_t<int DBPreviewImage::*, sqlite_orm::internal::empty_setter>>>;
+
+  // Only adds the (e.g. just decoded) preview to the in-memory cache
+  void cachePreviewImage(const QString& md5_hash, const int filesize, const QImage& image);
+
+  // Looks up the in-memory cache (and the atlas)
+  std::optional<QImage> getCachedPreviewImage(const QString& md5_hash, const int filesize) const;
+
+  // Looks up the database, the preview still needs to be decoded. Always empty for the ATLAS backend.
+  std::optional<EncodedPreviewImage> getEncodedPreviewImage(const QString& md5_hash, const int filesize) const;
+
+  using StorageType = CacheStorageType;
+  using PreviewImageLookupType = decltype(preparePreviewImageLookup(std::declval<StorageType&>()));
 
   std::unique_ptr<StorageType> storage_;
 
-  mutable QMap<QString, QImage> preview_image_cache_;
+  // Prepared once and reused for every lookup
+  std::unique_ptr<PreviewImageLookupType> preview_image_lookup_;
+
+  // Least recently used preview images, filled on demand
+  mutable QCache<QString, QImage> preview_image_cache_;
+
+  // Only used by the ATLAS backend, storage_ is not opened then
+  std::unique_ptr<PreviewAtlas> atlas_;
+
+private:
+  struct QueuedPreviewImage
+  {
+    QString md5_hash;
+    int filesize;
+    QImage image;
+  };
+
+  static QString cacheKey(const QString& md5_hash, const int filesize);
+
+  // Writes the queued previews in batches, until the connection is closed
+  void writeQueuedPreviewImages(const std::string& db_filename);
+
+  // Returns false if the writer should stop
+  bool takeQueuedPreviewImages(QList<QueuedPreviewImage>& preview_images, PreviewCodec& codec);
+
+  QThread* writer_thread_{nullptr};
+  QMutex writer_mutex_;
+  QWaitCondition writer_condition_;
+  QList<QueuedPreviewImage> queued_preview_images_;
+  PreviewCodec preview_codec_{PreviewCodec::QOI};
+  bool stop_writer_{false};
 };
@@ -0,0 +1,329 @@
+#include <algorithm>
+
+#include "filename_index.h"
+
+FilenamePattern::FilenamePattern(const QString& pattern, const Syntax syntax)
+    : pattern(pattern),
+      syntax(syntax)
+{
+  switch (syntax)
+  {
+    case Syntax::Substring:
+      break;
+
+    case Syntax::Glob:
+      regular_expression = QRegularExpression(QRegularExpression::wildcardToRegularExpression(pattern));
+      break;
+
+    case Syntax::RegularExpression:
+      regular_expression = QRegularExpression(pattern);
+      break;
+  }
+
+  // Compile it once here instead of on the first match (in one of the filter threads)
+  if (syntax != Syntax::Substring)
+  {
+    regular_expression.optimize();
+  }
+}
+
+bool FilenamePattern::isValid() const
+{
+  return syntax == Syntax::Substring || regular_expression.isValid();
+}
+
+bool FilenamePattern::matches(const QString& filename) const
+{
+  if (syntax == Syntax::Substring)
+  {
+    return filename.contains(pattern);
+  }
+
+  return regular_expression.isValid() && regular_expression.match(filename).hasMatch();
+}
+
+namespace
+{
+// Moves i (at the '[') to the closing ']' of a character class of a regular expression
+void skipCharacterClass(const QString& pattern, int& i)
+{
+  i++;
+
+  // A ']' right at the start is a literal
+  if (i < pattern.size() && pattern.at(i) == '^')
+  {
+    i++;
+  }
+  if (i < pattern.size() && pattern.at(i) == ']')
+  {
+    i++;
+  }
+
+  for (; i < pattern.size() && pattern.at(i) != ']'; i++)
+  {
+    if (pattern.at(i) == '\\')
+    {
+      i++;
+    }
+    else if (pattern.mid(i, 2) == "[:")
+    {
+      // E.g. [[:alpha:]]
+      const int end = pattern.indexOf(":]", i + 2);
+      i = end < 0 ? pattern.size() : end + 1;
+    }
+  }
+}
+} // namespace
+
+QStringList FilenamePattern::requiredSubstrings() const
+{
+  QStringList substrings;
+  QString substring;
+
+  const auto flush = [&substrings, &substring]()
+  {
+    if (!substring.isEmpty())
+    {
+      substrings.push_back(substring);
+      substring.clear();
+    }
+  };
+
+  switch (syntax)
+  {
+    case Syntax::Substring:
+      substring = pattern;
+      break;
+
+    case Syntax::Glob:
+      for (int i = 0; i < pattern.size(); i++)
+      {
+        if (pattern.at(i) == '*' || pattern.at(i) == '?')
+        {
+          flush();
+        }
+        else if (pattern.at(i) == '[')
+        {
+          // A character set like [0-9]
+          flush();
+
+          const int end = pattern.indexOf(']', i + 2);
+          if (end < 0)
+          {
+            return substrings;
+          }
+          i = end;
+        }
+        else
+        {
+          substring.push_back(pattern.at(i));
+        }
+      }
+      break;
+
+    case Syntax::RegularExpression:
+      // Only the literal characters outside of groups and character classes are collected (conservatively).
+      // Alternatives, inline options and lookarounds can make any of them optional => no substrings at all.
+      if (!regular_expression.isValid() || pattern.contains('|') || pattern.contains("(?"))
+      {
+        return {};
+      }
+
+      for (int i = 0; i < pattern.size(); i++)
+      {
+        const QChar c = pattern.at(i);
+
+        if (c == '\\' && i + 1 < pattern.size())
+        {
+          const QChar escaped = pattern.at(i + 1);
+          i++;
+
+          if (!escaped.isLetterOrNumber())
+          {
+            substring.push_back(escaped);
+          }
+          else if (QStringLiteral("dDwWsSbB").contains(escaped))
+          {
+            flush();
+          }
+          else
+          {
+            // E.g. \x41 or \p{L}
+            flush();
+            return substrings;
+          }
+        }
+        else if (c == '[')
+        {
+          flush();
+          skipCharacterClass(pattern, i);
+        }
+        else if (c == '(')
+        {
+          // Skip the whole group (incl. nested groups)
+          flush();
+
+          for (int depth = 0; i < pattern.size(); i++)
+          {
+            if (pattern.at(i) == '\\')
+            {
+              i++;
+            }
+            else if (pattern.at(i) == '[')
+            {
+              skipCharacterClass(pattern, i);
+            }
+            else if (pattern.at(i) == '(')
+            {
+              depth++;
+            }
+            else if (pattern.at(i) == ')' && --depth == 0)
+            {
+              break;
+            }
+          }
+        }
+        else if (c == '*' || c == '?' || c == '{')
+        {
+          // The preceding character is optional (or repeated an unknown number of times)
+          substring.chop(1);
+          flush();
+
+          if (c == '{')
+          {
+            const int end = pattern.indexOf('}', i);
+            if (end < 0)
+            {
+              return substrings;
+            }
+            i = end;
+          }
+        }
+        else if (c == '+' || c == '.' || c == '^' || c == '$')
+        {
+          flush();
+        }
+        else
+        {
+          substring.push_back(c);
+        }
+      }
+      break;
+  }
+
+  flush();
+
+  return substrings;
+}
+
+void FilenameIndex::reset()
+{
+  rows_by_trigram_.clear();
+  num_rows_ = 0;
+  outdated_ = true;
+}
+
+void FilenameIndex::insertRows(const QStringList& image_filenames, const int first, const int last)
+{
+  if (outdated_ || first != num_rows_)
+  {
+    outdated_ = true;
+    return;
+  }
+
+  addRows(image_filenames, first, last);
+}
+
+void FilenameIndex::removeRows(const int first, const int last)
+{
+  Q_UNUSED(first);
+  Q_UNUSED(last);
+
+  outdated_ = true;
+}
+
+void FilenameIndex::update(const QStringList& image_filenames)
+{
+  if (!outdated_ && num_rows_ == image_filenames.size())
+  {
+    return;
+  }
+
+  rows_by_trigram_.clear();
+  num_rows_ = 0;
+  outdated_ = false;
+
+  addRows(image_filenames, 0, image_filenames.size() - 1);
+}
+
+std::optional<RowBitmap> FilenameIndex::candidates(const FilenamePattern& pattern) const
+{
+  QList<quint64> pattern_trigrams;
+  for (const QString& substring : pattern.requiredSubstrings())
+  {
+    pattern_trigrams.append(trigrams(substring));
+  }
+
+  if (pattern_trigrams.isEmpty())
+  {
+    return std::nullopt;
+  }
+
+  QList<const RowBitmap*> trigram_rows;
+
+  for (const quint64 trigram : pattern_trigrams)
+  {
+    const auto rows = rows_by_trigram_.constFind(trigram);
+    if (rows == rows_by_trigram_.cend())
+    {
+      return RowBitmap();
+    }
+
+    trigram_rows.push_back(&rows.value());
+  }
+
+  // Start with the rarest trigram, so that the intersection is small right away
+  std::sort(trigram_rows.begin(),
+            trigram_rows.end(),
+            [](const RowBitmap* rows1, const RowBitmap* rows2) { return rows1->cardinality() < rows2->cardinality(); });
+
+  RowBitmap candidates = *trigram_rows.first();
+  for (int i = 1; i < trigram_rows.size() && !candidates.isEmpty(); i++)
+  {
+    candidates &= *trigram_rows.at(i);
+  }
+
+  return candidates;
+}
+
+void FilenameIndex::addRows(const QStringList& image_filenames, const int first, const int last)
+{
+  for (int row = first; row <= last; row++)
+  {
+    for (const quint64 trigram : trigrams(image_filenames.at(row)))
+    {
+      rows_by_trigram_[trigram].add(row);
+    }
+  }
+
+  num_rows_ += std::max(last - first + 1, 0);
+}
+
+QList<quint64> FilenameIndex::trigrams(const QString& text)
+{
+  // Lowercase => the candidates also cover case insensitive patterns
+  const QString lower_text = text.toLower();
+
+  QList<quint64> text_trigrams;
+
+  for (int i = 0; i + 2 < lower_text.size(); i++)
+  {
+    text_trigrams.push_back((quint64(lower_text.at(i).unicode()) << 32) | (quint64(lower_text.at(i + 1).unicode()) << 16) |
+                            quint64(lower_text.at(i + 2).unicode()));
+  }
+
+  std::sort(text_trigrams.begin(), text_trigrams.end());
+  text_trigrams.erase(std::unique(text_trigrams.begin(), text_trigrams.end()), text_trigrams.end());
+
+  return text_trigrams;
+}
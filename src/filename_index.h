@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+
+#include <optional>
+
+#include "row_bitmap.h"
+
+// A pattern that image filenames are filtered by
+struct FilenamePattern
+{
+  enum class Syntax
+  {
+    // The filename contains the pattern
+    Substring,
+    // The whole filename matches the wildcard pattern, e.g. "*_0001.jp*g"
+    Glob,
+    // The filename contains a match of the regular expression
+    RegularExpression
+  };
+
+  FilenamePattern(const QString& pattern = QString(), const Syntax syntax = Syntax::Substring);
+
+  // False for a regular expression with syntax errors, it matches no filename
+  bool isValid() const;
+
+  bool matches(const QString& filename) const;
+
+  // Literal strings that every matching filename contains.
+  // Only the parts that are certainly required are returned, so this can be empty.
+  QStringList requiredSubstrings() const;
+
+  QString pattern;
+  Syntax syntax{Syntax::Substring};
+
+  // For Glob and RegularExpression
+  QRegularExpression regular_expression;
+};
+
+// Trigram index over the image filenames: (lowercase) trigram -> rows of the filenames that contain it.
+// A pattern is first narrowed down to the rows that contain all trigrams of its required substrings,
+// only these have to be matched against the pattern.
+class FilenameIndex
+{
+public:
+  // Empties the index, it is built by the next update()
+  void reset();
+
+  // The rows first..last were inserted into image_filenames
+  void insertRows(const QStringList& image_filenames, const int first, const int last);
+  // The rows first..last were removed from image_filenames
+  void removeRows(const int first, const int last);
+
+  // Inserting / removing rows in the middle shifts all following rows, the index is then rebuilt here.
+  // Can take a while, so it is called on a copy in the background (see ImageSortFilterProxy).
+  void update(const QStringList& image_filenames);
+
+  // A superset of the rows that match the pattern, or nothing if the pattern has no trigrams to narrow the rows down by.
+  // The index has to be up to date (see update()).
+  std::optional<RowBitmap> candidates(const FilenamePattern& pattern) const;
+
+private:
+  QHash<quint64, RowBitmap> rows_by_trigram_;
+  int num_rows_{0};
+  bool outdated_{true};
+
+  void addRows(const QStringList& image_filenames, const int first, const int last);
+
+  static QList<quint64> trigrams(const QString& text);
+};
@@ -0,0 +1,163 @@
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include "folder_index.h"
+#include "yolo_label_parser.h"
+
+using namespace sqlite_orm;
+
+FolderIndex::FolderIndex(const QString& filename)
+{
+  storage_ = std::make_unique<StorageType>(makeFolderIndexStorage(filename.toStdString()));
+
+  storage_->sync_schema(false);
+
+  // Keep the connection, so that concurrent scans wait for each other instead of failing
+  storage_->open_forever();
+  storage_->busy_timeout(5000);
+}
+
+QHash<QString, ImageData> FolderIndex::load(const QString& image_folder)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  QHash<QString, ImageData> indexed_images;
+
+  const auto db_entries =
+      storage_->get_all<DBFolderIndexEntry>(where(c(&DBFolderIndexEntry::image_folder) == image_folder.toStdString()));
+
+  indexed_images.reserve(db_entries.size());
+
+  for (const DBFolderIndexEntry& db_entry : db_entries)
+  {
+    ImageData image_data;
+    image_data.image_filename = QString::fromStdString(db_entry.image_filename);
+    image_data.image_mtime = db_entry.image_mtime;
+    image_data.filesize = db_entry.filesize;
+    image_data.md5_hash = QByteArray(db_entry.md5_hash.data(), db_entry.md5_hash.size());
+    image_data.label_filename = QString::fromStdString(db_entry.label_filename);
+    image_data.label_mtime = db_entry.label_mtime;
+    image_data.label_filesize = db_entry.label_filesize;
+    image_data.min_rel_objet_size = db_entry.min_rel_object_size;
+    image_data.max_rel_objet_size = db_entry.max_rel_object_size;
+
+    for (const QString& label_id : QString::fromStdString(db_entry.label_ids).split(",", Qt::SkipEmptyParts))
+    {
+      image_data.label_ids.insert(label_id.toInt());
+    }
+
+    // Stored in the format of the label files
+    const YoloLabels labels =
+        YoloLabelParser::parse(QByteArrayView(db_entry.annotations.data(), qsizetype(db_entry.annotations.size())));
+
+    image_data.annotations.reserve(labels.annotations.size());
+    for (const YoloAnnotation& annotation : labels.annotations)
+    {
+      image_data.annotations.push_back(ImageAnnotation::fromYolo(annotation));
+    }
+
+    indexed_images.insert(image_data.image_filename, image_data);
+  }
+
+  qDebug() << "Loading " << indexed_images.size() << " indexed images took " << timer.elapsed() << "ms";
+
+  return indexed_images;
+}
+
+void FolderIndex::store(const QString& image_folder, const QList<ImageData>& image_data)
+{
+  if (image_data.isEmpty())
+  {
+    return;
+  }
+
+  std::vector<DBFolderIndexEntry> db_entries;
+  db_entries.reserve(image_data.size());
+
+  for (const ImageData& data : image_data)
+  {
+    DBFolderIndexEntry db_entry;
+    db_entry.image_folder = image_folder.toStdString();
+    db_entry.image_filename = data.image_filename.toStdString();
+    db_entry.image_mtime = data.image_mtime;
+    db_entry.filesize = data.filesize;
+    db_entry.md5_hash = std::vector<char>(data.md5_hash.begin(), data.md5_hash.end());
+    db_entry.label_filename = data.label_filename.toStdString();
+    db_entry.label_mtime = data.label_mtime;
+    db_entry.label_filesize = data.label_filesize;
+    db_entry.min_rel_object_size = data.min_rel_objet_size;
+    db_entry.max_rel_object_size = data.max_rel_objet_size;
+
+    QStringList label_ids;
+    for (const int label_id : data.label_ids)
+    {
+      label_ids.push_back(QString::number(label_id));
+    }
+    db_entry.label_ids = label_ids.join(",").toStdString();
+
+    QStringList annotation_lines;
+    for (const ImageAnnotation& annotation : data.annotations)
+    {
+      annotation_lines.push_back(QString("%1 %2 %3 %4 %5")
+                                     .arg(annotation.label_id)
+                                     .arg(annotation.x_center)
+                                     .arg(annotation.y_center)
+                                     .arg(annotation.width)
+                                     .arg(annotation.height));
+    }
+    db_entry.annotations = annotation_lines.join("\n").toStdString();
+
+    db_entries.push_back(db_entry);
+  }
+
+  // Upsert all entries in a single transaction.
+  // Every row is bound as 12 SQL parameters, so the rows are replaced in chunks below the parameter limit.
+  const size_t chunk_size = 64;
+
+  storage_->transaction(
+      [&]()
+      {
+        for (size_t first = 0; first < db_entries.size(); first += chunk_size)
+        {
+          const auto last = db_entries.begin() + std::min(first + chunk_size, db_entries.size());
+          storage_->replace_range(db_entries.begin() + first, last);
+        }
+        return true;
+      });
+}
+
+void FolderIndex::remove(const QString& image_folder, const QStringList& image_filenames)
+{
+  if (image_filenames.isEmpty())
+  {
+    return;
+  }
+
+  // Remove in chunks, every filename is bound as a separate SQL parameter
+  const int chunk_size = 500;
+
+  storage_->transaction(
+      [&]()
+      {
+        for (int first = 0; first < image_filenames.size(); first += chunk_size)
+        {
+          std::vector<std::string> db_image_filenames;
+          for (const QString& image_filename : image_filenames.mid(first, chunk_size))
+          {
+            db_image_filenames.push_back(image_filename.toStdString());
+          }
+
+          storage_->remove_all<DBFolderIndexEntry>(where(c(&DBFolderIndexEntry::image_folder) == image_folder.toStdString() and
+                                                         in(&DBFolderIndexEntry::image_filename, db_image_filenames)));
+        }
+        return true;
+      });
+}
+
+bool FolderIndex::isUpToDate(const ImageData& indexed_data, const ImageData& image_data)
+{
+  return indexed_data.filesize == image_data.filesize && indexed_data.image_mtime == image_data.image_mtime &&
+         indexed_data.label_filename == image_data.label_filename && indexed_data.label_mtime == image_data.label_mtime &&
+         indexed_data.label_filesize == image_data.label_filesize;
+}
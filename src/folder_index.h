@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <string>
+
+#include "image_folder_scanner.h"
+#include "sqlite_orm.h"
+
+struct DBFolderIndexEntry
+{
+  std::string image_folder;
+  std::string image_filename;
+  int64_t image_mtime;
+  int filesize;
+  std::vector<char> md5_hash;
+  std::string label_filename;
+  int64_t label_mtime;
+  int64_t label_filesize;
+  float min_rel_object_size;
+  float max_rel_object_size;
+  std::string label_ids;
+  std::string annotations;
+};
+
+inline auto makeFolderIndexStorage(const std::string& filename)
+{
+  using namespace sqlite_orm;
+  return make_storage(filename,
+                      make_table("folder_index",
+                                 make_column("image_folder", &DBFolderIndexEntry::image_folder),
+                                 make_column("image_filename", &DBFolderIndexEntry::image_filename),
+                                 make_column("image_mtime", &DBFolderIndexEntry::image_mtime),
+                                 make_column("filesize", &DBFolderIndexEntry::filesize),
+                                 make_column("md5_hash", &DBFolderIndexEntry::md5_hash),
+                                 make_column("label_filename", &DBFolderIndexEntry::label_filename),
+                                 make_column("label_mtime", &DBFolderIndexEntry::label_mtime),
+                                 make_column("label_filesize", &DBFolderIndexEntry::label_filesize),
+                                 make_column("min_rel_object_size", &DBFolderIndexEntry::min_rel_object_size),
+                                 make_column("max_rel_object_size", &DBFolderIndexEntry::max_rel_object_size),
+                                 make_column("label_ids", &DBFolderIndexEntry::label_ids),
+                                 make_column("annotations", &DBFolderIndexEntry::annotations),
+                                 primary_key(&DBFolderIndexEntry::image_folder, &DBFolderIndexEntry::image_filename)));
+}
+
+// On-disk index of the ImageData of all previously opened folders.
+// A folder is only rescanned for the images / labels whose mtime or size changed since they were indexed.
+class FolderIndex
+{
+public:
+  FolderIndex(const QString& filename);
+
+  QHash<QString, ImageData> load(const QString& image_folder);
+
+  void store(const QString& image_folder, const QList<ImageData>& image_data);
+  void remove(const QString& image_folder, const QStringList& image_filenames);
+
+  // True if image_data was scanned from the same image and label files as the indexed data
+  static bool isUpToDate(const ImageData& indexed_data, const ImageData& image_data);
+
+  using StorageType = decltype(makeFolderIndexStorage(""));
+
+private:
+  std::unique_ptr<StorageType> storage_;
+};
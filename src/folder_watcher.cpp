@@ -0,0 +1,214 @@
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSet>
+#include <QSocketNotifier>
+
+#include <algorithm>
+#include <iterator>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "folder_watcher.h"
+
+namespace
+{
+// Sorted by std::less, so that they can be compared with symmetricDifference() (QDir::Name sorts locale aware)
+QStringList sortedEntries(const QString& folder, const QDir::Filters filters)
+{
+  QStringList entries = QDir(folder).entryList(filters, QDir::Unsorted);
+  std::sort(entries.begin(), entries.end());
+  return entries;
+}
+
+// The names that are in only one of the sorted lists
+QStringList symmetricDifference(const QStringList& names1, const QStringList& names2)
+{
+  QStringList difference;
+  std::set_symmetric_difference(names1.begin(), names1.end(), names2.begin(), names2.end(), std::back_inserter(difference));
+  return difference;
+}
+} // namespace
+
+FolderWatcher::FolderWatcher(QObject* parent)
+    : QObject(parent)
+{
+#ifdef Q_OS_LINUX
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+  if (inotify_fd_ >= 0)
+  {
+    inotify_notifier_ = new QSocketNotifier(inotify_fd_, QSocketNotifier::Read, this);
+    connect(inotify_notifier_, &QSocketNotifier::activated, this, &FolderWatcher::readInotifyEvents);
+    return;
+  }
+
+  qWarning() << "inotify is not available, label files that are rewritten in place are not noticed";
+#endif
+
+  connect(&directory_watcher_, &QFileSystemWatcher::directoryChanged, this, &FolderWatcher::compareListings);
+}
+
+FolderWatcher::~FolderWatcher()
+{
+#ifdef Q_OS_LINUX
+  if (inotify_fd_ >= 0)
+  {
+    // Also removes all watches
+    close(inotify_fd_);
+  }
+#endif
+}
+
+void FolderWatcher::setFolders(const QStringList& folders)
+{
+  folders_ = folders;
+
+#ifdef Q_OS_LINUX
+  if (inotify_fd_ >= 0)
+  {
+    const QSet<QString> new_folders(folders.begin(), folders.end());
+
+    for (auto watch = folders_by_watch_.begin(); watch != folders_by_watch_.end();)
+    {
+      if (new_folders.contains(watch.value()))
+      {
+        watch++;
+        continue;
+      }
+
+      inotify_rm_watch(inotify_fd_, watch.key());
+      watch = folders_by_watch_.erase(watch);
+    }
+
+    for (const QString& folder : new_folders)
+    {
+      // The same folder always gets the same watch descriptor
+      const int watch = inotify_add_watch(inotify_fd_,
+                                          QFile::encodeName(folder).constData(),
+                                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ONLYDIR);
+      if (watch < 0)
+      {
+        qWarning() << "Can not watch" << folder;
+        continue;
+      }
+
+      folders_by_watch_.insert(watch, folder);
+    }
+
+    return;
+  }
+#endif
+
+  if (!directory_watcher_.directories().isEmpty())
+  {
+    directory_watcher_.removePaths(directory_watcher_.directories());
+  }
+
+  file_listings_.clear();
+  subfolder_listings_.clear();
+
+  for (const QString& folder : folders)
+  {
+    file_listings_.insert(folder, sortedEntries(folder, QDir::Files));
+    subfolder_listings_.insert(folder, sortedEntries(folder, QDir::Dirs | QDir::NoDotAndDotDot));
+  }
+
+  if (!folders.isEmpty())
+  {
+    directory_watcher_.addPaths(folders);
+  }
+}
+
+QStringList FolderWatcher::folders() const
+{
+  return folders_;
+}
+
+void FolderWatcher::readInotifyEvents()
+{
+#ifdef Q_OS_LINUX
+  QHash<QString, QStringList> changed_filenames;
+  QSet<QString> changed_folders;
+  bool lost = false;
+
+  alignas(inotify_event) char buffer[64 * 1024];
+
+  while (true)
+  {
+    const ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+    if (length <= 0)
+    {
+      break;
+    }
+
+    for (const char* position = buffer; position < buffer + length;)
+    {
+      const inotify_event* event = reinterpret_cast<const inotify_event*>(position);
+      position += sizeof(inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW)
+      {
+        lost = true;
+        continue;
+      }
+
+      const auto folder = folders_by_watch_.constFind(event->wd);
+
+      // Events of the folder itself (e.g. IN_IGNORED) have no name
+      if (folder == folders_by_watch_.cend() || event->len == 0)
+      {
+        continue;
+      }
+
+      if (event->mask & IN_ISDIR)
+      {
+        changed_folders.insert(folder.value());
+      }
+      else
+      {
+        changed_filenames[folder.value()].push_back(QFile::decodeName(event->name));
+      }
+    }
+  }
+
+  if (lost)
+  {
+    emit changesLost();
+  }
+
+  for (auto filenames = changed_filenames.cbegin(); filenames != changed_filenames.cend(); filenames++)
+  {
+    emit filesChanged(filenames.key(), filenames.value());
+  }
+
+  for (const QString& folder : changed_folders)
+  {
+    emit subfoldersChanged(folder);
+  }
+#endif
+}
+
+void FolderWatcher::compareListings(const QString& folder)
+{
+  const QStringList file_listing = sortedEntries(folder, QDir::Files);
+  const QStringList changed_filenames = symmetricDifference(file_listings_.value(folder), file_listing);
+  file_listings_.insert(folder, file_listing);
+
+  const QStringList subfolder_listing = sortedEntries(folder, QDir::Dirs | QDir::NoDotAndDotDot);
+  const bool subfolders_changed = subfolder_listings_.value(folder) != subfolder_listing;
+  subfolder_listings_.insert(folder, subfolder_listing);
+
+  if (!changed_filenames.isEmpty())
+  {
+    emit filesChanged(folder, changed_filenames);
+  }
+
+  if (subfolders_changed)
+  {
+    emit subfoldersChanged(folder);
+  }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QSocketNotifier;
+
+// Reports the names of the files in a set of folders that were added, removed, renamed or rewritten.
+// On Linux, this is one inotify watch per folder (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE),
+// so files that are rewritten in place are reported as well (e.g. our own label files or a re-run of a prediction).
+// Elsewhere (or if inotify is not available) the folders are watched by a QFileSystemWatcher and their listings are
+// compared with the previous ones: only files that appear or disappear are reported then, not files that are rewritten
+// in place or replaced by a rename.
+class FolderWatcher : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit FolderWatcher(QObject* parent = nullptr);
+  ~FolderWatcher();
+
+  // Replaces the watched folders (absolute paths)
+  void setFolders(const QStringList& folders);
+  QStringList folders() const;
+
+signals:
+  void filesChanged(const QString& folder, const QStringList& filenames);
+  // A subfolder of folder was added or removed
+  void subfoldersChanged(const QString& folder);
+  // More changes than could be queued, everything has to be checked again
+  void changesLost();
+
+private:
+  QStringList folders_;
+
+  int inotify_fd_{-1};
+  QSocketNotifier* inotify_notifier_{nullptr};
+  QHash<int, QString> folders_by_watch_;
+
+  void readInotifyEvents();
+
+  QFileSystemWatcher directory_watcher_;
+  // The sorted listings of the folders, for comparing them with the next ones
+  QHash<QString, QStringList> file_listings_;
+  QHash<QString, QStringList> subfolder_listings_;
+
+  void compareListings(const QString& folder);
+};
@@ -0,0 +1,179 @@
+#include <algorithm>
+
+#include <QtConcurrent>
+
+#include "image_filter.h"
+
+int ImageFilterColumns::size() const
+{
+  return int(num_objects.size());
+}
+
+void ImageFilterColumns::reset(const QList<ImageData>& image_data)
+{
+  num_objects.clear();
+  min_rel_object_sizes.clear();
+  max_rel_object_sizes.clear();
+  filesizes.clear();
+  image_filenames.clear();
+  label_ids.clear();
+
+  if (!image_data.isEmpty())
+  {
+    insertRows(image_data, 0, image_data.size() - 1);
+  }
+}
+
+void ImageFilterColumns::insertRows(const QList<ImageData>& image_data, const int first, const int last)
+{
+  const int count = last - first + 1;
+
+  num_objects.insert(num_objects.begin() + first, count, 0);
+  min_rel_object_sizes.insert(min_rel_object_sizes.begin() + first, count, 0.f);
+  max_rel_object_sizes.insert(max_rel_object_sizes.begin() + first, count, 0.f);
+  filesizes.insert(filesizes.begin() + first, count, 0);
+  image_filenames.insert(first, count, QString());
+  label_ids.insert(first, count, QSet<int>());
+
+  updateRows(image_data, first, last);
+}
+
+void ImageFilterColumns::removeRows(const int first, const int last)
+{
+  num_objects.erase(num_objects.begin() + first, num_objects.begin() + last + 1);
+  min_rel_object_sizes.erase(min_rel_object_sizes.begin() + first, min_rel_object_sizes.begin() + last + 1);
+  max_rel_object_sizes.erase(max_rel_object_sizes.begin() + first, max_rel_object_sizes.begin() + last + 1);
+  filesizes.erase(filesizes.begin() + first, filesizes.begin() + last + 1);
+  image_filenames.remove(first, last - first + 1);
+  label_ids.remove(first, last - first + 1);
+}
+
+void ImageFilterColumns::updateRows(const QList<ImageData>& image_data, const int first, const int last)
+{
+  for (int row = first; row <= last; row++)
+  {
+    const ImageData& data = image_data.at(row);
+
+    num_objects[row] = data.annotations.size();
+    min_rel_object_sizes[row] = data.min_rel_objet_size;
+    max_rel_object_sizes[row] = data.max_rel_objet_size;
+    filesizes[row] = data.filesize;
+    image_filenames[row] = data.image_filename;
+    label_ids[row] = data.label_ids;
+  }
+}
+
+void ImageFilter::evaluate(
+    const ImageFilterColumns& columns, const ImageFilterCandidates& candidates, const int first, const int last, char* accepted) const
+{
+  for (int row = first; row <= last; row++)
+  {
+    accepted[row] = 1;
+  }
+
+  // One loop per active filter over its column(s), rows that are already rejected are skipped
+
+  // Filter by rel. object size
+  if (rel_object_size)
+  {
+    const float min_rel_object_size = rel_object_size->first;
+    const float max_rel_object_size = rel_object_size->second;
+
+    for (int row = first; row <= last; row++)
+    {
+      accepted[row] &= columns.min_rel_object_sizes[row] >= min_rel_object_size &&
+                       columns.max_rel_object_sizes[row] <= max_rel_object_size &&
+                       (min_rel_object_size <= 0.f || columns.num_objects[row] > 0);
+    }
+  }
+
+  // Filter by num. objects
+  if (num_objects)
+  {
+    const int min_num_objects = num_objects->first;
+    const int max_num_objects = num_objects->second;
+
+    for (int row = first; row <= last; row++)
+    {
+      accepted[row] &= columns.num_objects[row] >= min_num_objects && columns.num_objects[row] <= max_num_objects;
+    }
+  }
+
+  // Filter by labels
+  if (label_query && candidates.label_rows)
+  {
+    std::vector<char> label_mask(last - first + 1);
+    candidates.label_rows->toMask(first, last, label_mask.data());
+
+    for (int row = first; row <= last; row++)
+    {
+      accepted[row] &= label_mask[row - first];
+    }
+  }
+  else if (label_query)
+  {
+    for (int row = first; row <= last; row++)
+    {
+      if (accepted[row])
+      {
+        accepted[row] = label_query->matches(columns.label_ids.at(row));
+      }
+    }
+  }
+
+  // Filter by filename (the most expensive one, so only for the remaining rows)
+  if (filename_pattern)
+  {
+    // Only the candidates of the filename index can match
+    std::vector<char> filename_mask;
+    if (candidates.filename_rows)
+    {
+      filename_mask.resize(last - first + 1);
+      candidates.filename_rows->toMask(first, last, filename_mask.data());
+    }
+
+    for (int row = first; row <= last; row++)
+    {
+      if (accepted[row] && (filename_mask.empty() || filename_mask[row - first]))
+      {
+        accepted[row] = filename_pattern->matches(columns.image_filenames.at(row));
+      }
+      else
+      {
+        accepted[row] = 0;
+      }
+    }
+  }
+}
+
+void ImageFilter::evaluateParallel(const ImageFilterColumns& columns,
+                                   const ImageFilterCandidates& candidates,
+                                   const int first,
+                                   const int last,
+                                   char* accepted,
+                                   const std::atomic<bool>* cancelled) const
+{
+  if (last - first < chunk_size_)
+  {
+    evaluate(columns, candidates, first, last, accepted);
+    return;
+  }
+
+  QList<int> chunk_firsts;
+  for (int chunk_first = first; chunk_first <= last; chunk_first += chunk_size_)
+  {
+    chunk_firsts.push_back(chunk_first);
+  }
+
+  // Every chunk writes its own range of accepted
+  QtConcurrent::blockingMap(chunk_firsts,
+                            [&](const int chunk_first)
+                            {
+                              if (cancelled && *cancelled)
+                              {
+                                return;
+                              }
+
+                              evaluate(columns, candidates, chunk_first, std::min(chunk_first + chunk_size_ - 1, last), accepted);
+                            });
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <optional>
+#include <vector>
+
+#include "filename_index.h"
+#include "image_folder_scanner.h"
+#include "label_index.h"
+#include "row_bitmap.h"
+
+// Typed, column-wise copy of the ImageData fields that the images are filtered and sorted by.
+// The rows are the rows of the ImageListModel and are kept in sync with it row range by row range.
+class ImageFilterColumns
+{
+public:
+  int size() const;
+
+  void reset(const QList<ImageData>& image_data);
+  // The rows first..last were inserted into image_data
+  void insertRows(const QList<ImageData>& image_data, const int first, const int last);
+  void removeRows(const int first, const int last);
+  // The rows first..last of image_data were changed
+  void updateRows(const QList<ImageData>& image_data, const int first, const int last);
+
+  std::vector<int> num_objects;
+  std::vector<float> min_rel_object_sizes;
+  std::vector<float> max_rel_object_sizes;
+  std::vector<int> filesizes;
+  QStringList image_filenames;
+  QList<QSet<int>> label_ids;
+};
+
+// Rows preselected by the LabelIndex / FilenameIndex of the filter columns.
+// Without them (e.g. for a few changed rows) the rows are tested one by one.
+struct ImageFilterCandidates
+{
+  // The rows that match the label query
+  std::optional<RowBitmap> label_rows;
+  // A superset of the rows that match the filename pattern, if it could be narrowed down
+  std::optional<RowBitmap> filename_rows;
+};
+
+// The filters set in ImageSortFilterProxy
+struct ImageFilter
+{
+  std::optional<FilenamePattern> filename_pattern;
+  std::optional<QPair<float, float>> rel_object_size;
+  std::optional<QPair<int, int>> num_objects;
+  std::optional<LabelQuery> label_query;
+
+  // Writes 1 (accepted) or 0 for the rows first..last to accepted[first..last].
+  void evaluate(const ImageFilterColumns& columns,
+                const ImageFilterCandidates& candidates,
+                const int first,
+                const int last,
+                char* accepted) const;
+
+  // Same as evaluate(), but the rows are split into chunks that are evaluated on the global thread pool
+  // (so it must not be called from a thread of the global pool itself, it would wait for its own pool).
+  // Chunks that are not started yet are skipped once cancelled is set.
+  void evaluateParallel(const ImageFilterColumns& columns,
+                        const ImageFilterCandidates& candidates,
+                        const int first,
+                        const int last,
+                        char* accepted,
+                        const std::atomic<bool>* cancelled = nullptr) const;
+
+private:
+  static constexpr int chunk_size_ = 16384;
+};
@@ -0,0 +1,307 @@
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent>
+
+#include "folder_index.h"
+#include "image_folder_scanner.h"
+#include "yolo_label_parser.h"
+
+ImageAnnotation ImageAnnotation::fromYolo(const YoloAnnotation& annotation)
+{
+  return ImageAnnotation{annotation.x_center, annotation.y_center, annotation.width, annotation.height, annotation.label_id};
+}
+
+QString AnnotationFolders::labelFilename(const QString& image_filename) const
+{
+  // Try primary labelfile
+  const QString label_filename = imageFilenameToLabelFilename(image_filename);
+
+  if (QFile::exists(primary + "/" + label_filename))
+  {
+    return primary + "/" + label_filename;
+  }
+
+  for (const QString& annotation_folder : secondary)
+  {
+    if (QFile::exists(annotation_folder + "/" + label_filename))
+    {
+      return annotation_folder + "/" + label_filename;
+    }
+  }
+
+  // Fallback: No annotation file is available
+  return "";
+}
+
+QString AnnotationFolders::imageFilenameToLabelFilename(const QString& image_filename)
+{
+  return QFileInfo(image_filename).completeBaseName() + ".txt";
+}
+
+ImageFolderScanner::ImageFolderScanner(const QString& image_folder,
+                                       const AnnotationFolders& annotation_folders,
+                                       const QHash<QString, ImageData>& indexed_images)
+    : image_folder_(image_folder),
+      annotation_folders_(annotation_folders),
+      indexed_images_(indexed_images)
+{
+}
+
+QList<ImageData> ImageFolderScanner::scan(const QStringList& image_filenames) const
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  QList<ImageData> image_data =
+      QtConcurrent::blockingMapped(image_filenames, [this](const QString& image_filename) { return scanImage(image_filename); });
+
+  qDebug() << "Scanning " << image_filenames.size() << " images took " << timer.elapsed() << "ms";
+
+  return image_data;
+}
+
+ImageData ImageFolderScanner::scanImage(const QString& image_filename) const
+{
+  ImageData new_elem;
+  new_elem.image_filename = image_filename;
+
+  // Load image data
+  const QFileInfo image_info(image_folder_ + "/" + new_elem.image_filename);
+  new_elem.filesize = image_info.size();
+  new_elem.image_mtime = image_info.lastModified().toMSecsSinceEpoch();
+
+  const auto indexed = indexed_images_.constFind(image_filename);
+
+  if (indexed != indexed_images_.constEnd() && indexed->filesize == new_elem.filesize &&
+      indexed->image_mtime == new_elem.image_mtime)
+  {
+    new_elem.md5_hash = indexed->md5_hash;
+  }
+  else
+  {
+    // Hash the first 5kByte of image data
+    QFile image_file(image_info.filePath());
+    image_file.open(QIODevice::ReadOnly);
+    new_elem.md5_hash = QCryptographicHash::hash(image_file.read(1024 * 5), QCryptographicHash::Algorithm::Md5);
+  }
+
+  // Load annotation data
+  scanAnnotations(new_elem);
+
+  return new_elem;
+}
+
+void ImageFolderScanner::scanAnnotations(ImageData& image_data) const
+{
+  image_data.label_filename = annotation_folders_.labelFilename(image_data.image_filename);
+  image_data.label_mtime = 0;
+  image_data.label_filesize = 0;
+
+  if (!image_data.label_filename.isEmpty())
+  {
+    const QFileInfo label_info(image_data.label_filename);
+    image_data.label_mtime = label_info.lastModified().toMSecsSinceEpoch();
+    image_data.label_filesize = label_info.size();
+  }
+
+  const auto indexed = indexed_images_.constFind(image_data.image_filename);
+
+  if (indexed != indexed_images_.constEnd() && indexed->label_filename == image_data.label_filename &&
+      indexed->label_mtime == image_data.label_mtime && indexed->label_filesize == image_data.label_filesize)
+  {
+    image_data.min_rel_objet_size = indexed->min_rel_objet_size;
+    image_data.max_rel_objet_size = indexed->max_rel_objet_size;
+    image_data.label_ids = indexed->label_ids;
+    image_data.annotations = indexed->annotations;
+  }
+  else
+  {
+    image_data.min_rel_objet_size = std::numeric_limits<float>::infinity();
+    image_data.max_rel_objet_size = 0.f;
+    image_data.label_ids.clear();
+    image_data.annotations.clear();
+
+    loadAnnotations(image_data.label_filename, image_data);
+  }
+}
+
+bool ImageFolderScanner::updateAnnotations(ImageData& image_data) const
+{
+  const QString label_filename = annotation_folders_.labelFilename(image_data.image_filename);
+
+  qint64 label_mtime = 0;
+  qint64 label_filesize = 0;
+
+  if (!label_filename.isEmpty())
+  {
+    const QFileInfo label_info(label_filename);
+    label_mtime = label_info.lastModified().toMSecsSinceEpoch();
+    label_filesize = label_info.size();
+  }
+
+  if (label_filename == image_data.label_filename && label_mtime == image_data.label_mtime &&
+      label_filesize == image_data.label_filesize)
+  {
+    return false;
+  }
+
+  image_data.label_filename = label_filename;
+  image_data.label_mtime = label_mtime;
+  image_data.label_filesize = label_filesize;
+
+  image_data.min_rel_objet_size = std::numeric_limits<float>::infinity();
+  image_data.max_rel_objet_size = 0.f;
+  image_data.label_ids.clear();
+  image_data.annotations.clear();
+
+  loadAnnotations(image_data.label_filename, image_data);
+
+  return true;
+}
+
+void ImageFolderScanner::loadAnnotations(const QString& label_filename, ImageData& image_data)
+{
+  const YoloLabels labels = YoloLabelParser::parseFile(label_filename);
+
+  for (const QString& error : labels.errors)
+  {
+    qWarning() << "Invalid annotation in" << label_filename << error;
+  }
+
+  image_data.annotations.reserve(labels.annotations.size());
+
+  for (const YoloAnnotation& annotation : labels.annotations)
+  {
+    image_data.annotations.push_back(ImageAnnotation::fromYolo(annotation));
+
+    image_data.min_rel_objet_size = std::min(annotation.width, std::min(annotation.height, image_data.min_rel_objet_size));
+    image_data.max_rel_objet_size = std::max(annotation.width, std::max(annotation.height, image_data.max_rel_objet_size));
+
+    image_data.label_ids.insert(annotation.label_id);
+  }
+}
+
+AsyncImageFolderScanner::AsyncImageFolderScanner(const QString& folder_index_filename, QObject* parent)
+    : QObject(parent),
+      folder_index_filename_(folder_index_filename)
+{
+}
+
+AsyncImageFolderScanner::~AsyncImageFolderScanner()
+{
+  cancel();
+  future_.waitForFinished();
+}
+
+void AsyncImageFolderScanner::start(const QString& image_folder,
+                                    const AnnotationFolders& annotation_folders,
+                                    const QStringList& image_filenames)
+{
+  cancel();
+
+  // Every scan gets its own flag, so a previous scan that is still winding down can not emit anything anymore
+  auto cancelled = std::make_shared<std::atomic<bool>>(false);
+  cancelled_ = cancelled;
+  running_ = true;
+
+  timer_.start();
+
+  future_ = QtConcurrent::run(
+      [this, folder_index_filename = folder_index_filename_, image_folder, annotation_folders, image_filenames, cancelled]()
+      {
+        FolderIndex folder_index(folder_index_filename);
+        const QHash<QString, ImageData> indexed_images = folder_index.load(image_folder);
+
+        const ImageFolderScanner scanner(image_folder, annotation_folders, indexed_images);
+
+        // Images that are new or changed since they were indexed
+        QList<ImageData> outdated_images;
+
+        for (int first = 0; first < image_filenames.size(); first += batch_size_)
+        {
+          if (*cancelled)
+          {
+            break;
+          }
+
+          const QStringList batch_filenames = image_filenames.mid(first, batch_size_);
+
+          QList<ImageData> batch = QtConcurrent::blockingMapped(
+              batch_filenames, [&scanner](const QString& image_filename) { return scanner.scanImage(image_filename); });
+
+          for (const ImageData& image_data : batch)
+          {
+            const auto indexed = indexed_images.constFind(image_data.image_filename);
+
+            if (indexed == indexed_images.constEnd() || !FolderIndex::isUpToDate(*indexed, image_data))
+            {
+              outdated_images.push_back(image_data);
+            }
+          }
+
+          // Emit from the thread of this object, after checking that the scan is still wanted
+          QMetaObject::invokeMethod(
+              this,
+              [this, batch, cancelled]()
+              {
+                if (!*cancelled)
+                {
+                  emit imagesScanned(batch);
+                }
+              },
+              Qt::QueuedConnection);
+        }
+
+        // Keep what was scanned so far, even if the scan was cancelled
+        folder_index.store(image_folder, outdated_images);
+
+        if (*cancelled)
+        {
+          return;
+        }
+
+        // Forget about images that do not exist anymore
+        const QSet<QString> existing_image_filenames(image_filenames.begin(), image_filenames.end());
+        QStringList removed_image_filenames;
+        for (auto it = indexed_images.constBegin(); it != indexed_images.constEnd(); it++)
+        {
+          if (!existing_image_filenames.contains(it.key()))
+          {
+            removed_image_filenames.push_back(it.key());
+          }
+        }
+        folder_index.remove(image_folder, removed_image_filenames);
+
+        QMetaObject::invokeMethod(
+            this,
+            [this, cancelled, num_images = image_filenames.size(), num_outdated_images = outdated_images.size()]()
+            {
+              if (!*cancelled)
+              {
+                running_ = false;
+                qDebug() << "Scanning " << num_images << " images (" << num_outdated_images << " changed) took "
+                         << timer_.elapsed() << "ms";
+                emit finished();
+              }
+            },
+            Qt::QueuedConnection);
+      });
+}
+
+void AsyncImageFolderScanner::cancel()
+{
+  if (cancelled_)
+  {
+    *cancelled_ = true;
+  }
+
+  running_ = false;
+}
+
+bool AsyncImageFolderScanner::isRunning() const
+{
+  return running_;
+}
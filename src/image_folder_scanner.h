@@ -0,0 +1,122 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <limits>
+#include <memory>
+
+#include "yolo_label_parser.h"
+
+// One bounding box of a label file, in relative YOLO coordinates (20 bytes instead of a QStringList per line)
+struct ImageAnnotation
+{
+  float x_center{0.f};
+  float y_center{0.f};
+  float width{0.f};
+  float height{0.f};
+  int label_id{0};
+
+  static ImageAnnotation fromYolo(const YoloAnnotation& annotation);
+};
+
+struct ImageData
+{
+  QString image_filename;
+  QByteArray md5_hash;
+  int filesize{0};
+  qint64 image_mtime{0};
+  QString label_filename;
+  qint64 label_mtime{0};
+  qint64 label_filesize{0};
+  float min_rel_objet_size{std::numeric_limits<float>::infinity()};
+  float max_rel_objet_size{0.f};
+  QSet<int> label_ids;
+  QList<ImageAnnotation> annotations;
+};
+
+// The folders that are searched (in this order) for the label file of an image.
+// All paths are absolute, so that the lookups can be done from worker threads.
+struct AnnotationFolders
+{
+  QString primary;
+  QStringList secondary;
+
+  QString labelFilename(const QString& image_filename) const;
+
+  static QString imageFilenameToLabelFilename(const QString& image_filename);
+};
+
+// Collects the ImageData (hash, filesize and annotation summary) of all images of a folder.
+// This does not depend on any GUI class, so it can be used (and timed) on its own.
+// Images (and labels) that are unchanged compared to indexed_images are not read again.
+class ImageFolderScanner
+{
+public:
+  ImageFolderScanner(const QString& image_folder,
+                     const AnnotationFolders& annotation_folders,
+                     const QHash<QString, ImageData>& indexed_images = {});
+
+  // Scans all given images on the global thread pool.
+  // The result has the same order as image_filenames.
+  QList<ImageData> scan(const QStringList& image_filenames) const;
+
+  ImageData scanImage(const QString& image_filename) const;
+
+  // Resolves the label file of image_data and updates its annotation summary
+  void scanAnnotations(ImageData& image_data) const;
+
+  // Like scanAnnotations(), but only parses the label file if it differs from the one image_data was scanned from.
+  // Returns true if the annotations of image_data were updated.
+  bool updateAnnotations(ImageData& image_data) const;
+
+  static void loadAnnotations(const QString& label_filename, ImageData& image_data);
+
+private:
+  const QString image_folder_;
+  const AnnotationFolders annotation_folders_;
+  const QHash<QString, ImageData> indexed_images_;
+};
+
+// Runs an ImageFolderScanner in the background and hands out the results in batches (in folder order),
+// so that the model can be populated while the folder is still being scanned.
+// The FolderIndex in folder_index_filename is used to skip unchanged images and is updated afterwards.
+class AsyncImageFolderScanner : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit AsyncImageFolderScanner(const QString& folder_index_filename, QObject* parent = nullptr);
+  ~AsyncImageFolderScanner();
+
+  // Cancels a running scan before starting the new one.
+  void start(const QString& image_folder, const AnnotationFolders& annotation_folders, const QStringList& image_filenames);
+
+  // No more batches of the current scan are emitted after this returns.
+  void cancel();
+
+  bool isRunning() const;
+
+signals:
+  void imagesScanned(const QList<ImageData>& image_data);
+  void finished();
+
+private:
+  static constexpr int batch_size_ = 256;
+
+  const QString folder_index_filename_;
+
+  QFuture<void> future_;
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+  bool running_{false};
+
+  QElapsedTimer timer_;
+};
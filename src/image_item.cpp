@@ -0,0 +1,25 @@
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include "image_item.h"
+
+ImageItem::ImageItem(const QImage& image, QGraphicsItem* parent)
+    : QGraphicsItem(parent),
+      image_(image)
+{
+  // Needed to get the exposed rect in paint()
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QRectF ImageItem::boundingRect() const
+{
+  return QRectF(QPointF(0, 0), image_.size());
+}
+
+void ImageItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+  // Only the exposed part, the item coordinates are the image coordinates
+  const QRectF exposed_rect = option->exposedRect.intersected(boundingRect());
+
+  painter->drawImage(exposed_rect, image_, exposed_rect);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QGraphicsItem>
+#include <QImage>
+
+// Draws a QImage directly, instead of converting (and copying) it into a QPixmap first.
+// Images in the format of the raster paint engine (see ImagePrefetcher::decodeImage()) are drawn without any conversion.
+class ImageItem : public QGraphicsItem
+{
+public:
+  explicit ImageItem(const QImage& image, QGraphicsItem* parent = nullptr);
+
+  QRectF boundingRect() const override;
+  void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+private:
+  const QImage image_;
+};
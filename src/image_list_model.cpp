@@ -1,16 +1,103 @@
-#include <QCryptographicHash>
 #include <QDirIterator>
 #include <QElapsedTimer>
+#include <QFileInfo>
 #include <QImage>
 #include <QPainter>
+#include <QtConcurrent>
+
+#include <numeric>
+#include <optional>
+#include <utility>
 
 #include "image_list_model.h"
 #include "label_colors.h"
 
-ImageListModel::ImageListModel(const QDir& root_path, QObject* parent)
+ImageListModel::ImageListModel(const QDir& root_path, const PreviewCacheBackend preview_cache_backend, QObject* parent)
     : QAbstractListModel{parent},
-      cache_db_(root_path)
+      cache_db_(root_path, preview_cache_backend),
+      folder_scanner_(root_path.absoluteFilePath("folder_index.sqlite"))
 {
+  // Append the scanned images batch by batch, so that the views can already be used while the folder is scanned
+  connect(&folder_scanner_,
+          &AsyncImageFolderScanner::imagesScanned,
+          this,
+          [this](const QList<ImageData>& image_data)
+          {
+            const int first = image_data_.size();
+
+            this->beginInsertRows(QModelIndex(), first, first + image_data.size() - 1);
+            image_data_.append(image_data);
+            rows_by_label_filename_outdated_ = true;
+            this->endInsertRows();
+          });
+
+  connect(&thumbnail_loader_,
+          &ThumbnailLoader::previewImageReady,
+          this,
+          [this](const QString& md5_hash, const int filesize, const QImage& preview_image, const bool created)
+          {
+            if (created)
+            {
+              cache_db_.storePreviewImage(md5_hash, filesize, preview_image);
+            }
+            else
+            {
+              cache_db_.cachePreviewImage(md5_hash, filesize, preview_image);
+            }
+
+            for (const QPersistentModelIndex& index : pending_preview_indices_.values(ThumbnailLoader::key(md5_hash, filesize)))
+            {
+              if (index.isValid())
+              {
+                emit dataChanged(index, index, {Qt::DecorationRole});
+              }
+            }
+            pending_preview_indices_.remove(ThumbnailLoader::key(md5_hash, filesize));
+          });
+
+  folder_update_timer_.setSingleShot(true);
+  folder_update_timer_.setInterval(500);
+
+  connect(&folder_watcher_,
+          &FolderWatcher::filesChanged,
+          this,
+          [this](const QString& folder, const QStringList& filenames)
+          {
+            for (const QString& filename : filenames)
+            {
+              if (filename.endsWith(".txt"))
+              {
+                changed_label_filenames_.insert(filename);
+              }
+              else if (folder == current_image_folder_.absolutePath())
+              {
+                images_changed_ = true;
+              }
+            }
+
+            folder_update_timer_.start();
+          });
+  connect(&folder_watcher_,
+          &FolderWatcher::subfoldersChanged,
+          this,
+          [this]()
+          {
+            annotation_folders_changed_ = true;
+            folder_update_timer_.start();
+          });
+  connect(&folder_watcher_,
+          &FolderWatcher::changesLost,
+          this,
+          [this]()
+          {
+            images_changed_ = true;
+            annotation_folders_changed_ = true;
+            all_labels_changed_ = true;
+            folder_update_timer_.start();
+          });
+  connect(&folder_update_timer_, &QTimer::timeout, this, [this]() { updateFromDisk(); });
+
+  connect(&image_prefetcher_, &ImagePrefetcher::imageReady, this, &ImageListModel::fullResImageReady);
 }
 
 void ImageListModel::openFolder(const QString& folder, const Mode& folder_mode)
@@ -18,6 +105,14 @@ void ImageListModel::openFolder(const QString& folder, const Mode& folder_mode)
   folder_mode_ = folder_mode;
   opened_folder_ = folder;
 
+  folder_scanner_.cancel();
+  cancelLabelUpdate();
+
+  thumbnail_loader_.cancelAll();
+  pending_preview_indices_.clear();
+
+  image_prefetcher_.clear();
+
   this->beginResetModel();
 
   qDebug() << "=================================================";
@@ -27,13 +122,59 @@ void ImageListModel::openFolder(const QString& folder, const Mode& folder_mode)
   QElapsedTimer timer;
   timer.start();
 
+  updateAnnotationFolders(folder, folder_mode);
+
+  QStringList all_image_file_names = current_image_folder_.entryList(image_filename_filter_, QDir::Filter::Files, QDir::Name);
+
+  image_data_.clear();
+  rows_by_label_filename_outdated_ = true;
+
+  qDebug() << "openFolder took " << timer.elapsed() << "ms";
+
+  this->endResetModel();
+
+  // Hash the images and parse their labels in the background, the rows are appended as they come in
+  folder_scanner_.start(current_image_folder_.absolutePath(), annotation_folders_, all_image_file_names);
+}
+
+void ImageListModel::setFolderMode(const Mode& folder_mode)
+{
+  // The image list is not complete yet => just start over
+  if (folder_scanner_.isRunning())
+  {
+    openFolder(opened_folder_, folder_mode);
+    return;
+  }
+
+  folder_mode_ = folder_mode;
+
+  cancelLabelUpdate();
+
+  this->beginResetModel();
+
+  QElapsedTimer timer;
+  timer.start();
+
+  updateAnnotationFolders(opened_folder_, folder_mode);
+
+  // Only the labels depend on the mode, the image side (filename, filesize, md5_hash) is kept
+  const ImageFolderScanner scanner(current_image_folder_.absolutePath(), annotation_folders_);
+  QtConcurrent::blockingMap(image_data_, [&scanner](ImageData& image_data) { scanner.scanAnnotations(image_data); });
+
+  qDebug() << "setFolderMode took " << timer.elapsed() << "ms";
+
+  this->endResetModel();
+}
+
+void ImageListModel::updateAnnotationFolders(const QString& folder, const Mode& folder_mode)
+{
   // A "normal" folder
   // -> Load images from the folder itself
   // -> Primary annotations are right next to the image folder
   if (!folder.contains("pred"))
   {
     current_image_folder_ = QDir(folder);
-    primary_annotations_folder_ = QDir(folder);
+    annotation_folders_.primary = current_image_folder_.absolutePath();
   }
 
   // A "pred" folder
@@ -47,17 +188,17 @@ void ImageListModel::openFolder(const QString& folder, const Mode& folder_mode)
 
     if (folder_mode == Mode::ANNOTATION)
     {
-      primary_annotations_folder_ = current_image_folder_;
+      annotation_folders_.primary = current_image_folder_.absolutePath();
     }
 
     else if (folder_mode == Mode::REVIEW)
     {
-      primary_annotations_folder_ = QDir(folder);
+      annotation_folders_.primary = QDir(folder).absolutePath();
     }
   }
 
   // All subdirectories are potential folders for secondary annotions
-  secondary_annotations_folders_.clear();
+  annotation_folders_.secondary.clear();
   {
     QDirIterator it(
         current_image_folder_.path(), QStringList() << "*", QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
@@ -70,86 +211,277 @@ void ImageListModel::openFolder(const QString& folder, const Mode& folder_mode)
       if (new_folder.startsWith(folder))
       {
         // qDebug() << "Prepending " << new_folder;
-        secondary_annotations_folders_.prepend(new_folder);
+        annotation_folders_.secondary.prepend(QDir(new_folder).absolutePath());
       }
       else if (folder_mode == Mode::ANNOTATION)
       {
         // qDebug() << "Appending " << new_folder;
-        secondary_annotations_folders_.append(new_folder);
+        annotation_folders_.secondary.append(QDir(new_folder).absolutePath());
       }
     }
 
     // qDebug() << "secondary_annotations_folders_:";
-    // for (const auto& x : secondary_annotations_folders_)
+    // for (const auto& x : annotation_folders_.secondary)
     // {
-    //   qDebug() << x.path();
+    //   qDebug() << x;
     // }
   }
 
-  QStringList all_image_file_names = current_image_folder_.entryList(image_filename_filter_, QDir::Filter::Files, QDir::Name);
+  // Watch the image folder and all annotation folders (see FolderWatcher for which changes are noticed)
+  {
+    QSet<QString> watched_folders(annotation_folders_.secondary.begin(), annotation_folders_.secondary.end());
+    watched_folders.insert(current_image_folder_.absolutePath());
+    watched_folders.insert(annotation_folders_.primary);
 
-  image_data_.clear();
+    folder_watcher_.setFolders(watched_folders.values());
+  }
 
-  for (const QString& image_filename : all_image_file_names)
+  // The watches only report what changes from now on
+  images_changed_ = false;
+  annotation_folders_changed_ = false;
+  all_labels_changed_ = false;
+  changed_label_filenames_.clear();
+}
+
+void ImageListModel::updateFromDisk()
+{
+  // The scan will already see the latest state, a running label update is applied first
+  if (folder_scanner_.isRunning() || label_update_running_)
   {
-    ImageData new_elem;
-    new_elem.image_filename = image_filename;
+    folder_update_timer_.start();
+    return;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
 
-    // Load image data
-    QFile image_file(current_image_folder_.absoluteFilePath(new_elem.image_filename));
-    new_elem.filesize = image_file.size();
+  updating_from_disk_ = true;
 
-    // Hash the first 5kByte of image data
-    image_file.open(QIODevice::ReadOnly);
-    new_elem.md5_hash = QCryptographicHash::hash(image_file.read(1024 * 5), QCryptographicHash::Algorithm::Md5);
+  // Take the collected changes, the ones that come in from now on are applied by the next update
+  const bool images_changed = images_changed_;
+  const bool annotation_folders_changed = annotation_folders_changed_;
+  const bool all_labels_changed = all_labels_changed_;
+  QSet<QString> changed_label_filenames = changed_label_filenames_;
 
-    // Load annotation data
-    const QString label_filename = getLabelFilename(image_filename);
+  // New subfolders (e.g. from a YOLO prediction) are new annotation folders
+  if (annotation_folders_changed)
+  {
+    QSet<QString> previous_folders(annotation_folders_.secondary.begin(), annotation_folders_.secondary.end());
+    previous_folders.insert(annotation_folders_.primary);
 
-    QFile file(current_image_folder_.absoluteFilePath(label_filename));
-    if (file.open(QIODevice::ReadOnly))
-    {
-      QTextStream in(&file);
+    updateAnnotationFolders(opened_folder_, folder_mode_);
 
-      while (!in.atEnd())
-      {
-        QString line = in.readLine();
+    QSet<QString> folders(annotation_folders_.secondary.begin(), annotation_folders_.secondary.end());
+    folders.insert(annotation_folders_.primary);
 
-        QStringList fields = line.split(" ");
+    // The label files of added folders can be new labels of images (or take precedence over the current ones)
+    for (const QString& folder : folders - previous_folders)
+    {
+      for (const QString& label_filename : QDir(folder).entryList({"*.txt"}, QDir::Files))
+      {
+        changed_label_filenames.insert(label_filename);
+      }
+    }
 
-        if (!std::isfinite(fields[1].toFloat()) || !std::isfinite(fields[2].toFloat()) || !std::isfinite(fields[3].toFloat()))
+    // The labels of removed folders are gone
+    const QSet<QString> removed_folders = previous_folders - folders;
+    if (!removed_folders.isEmpty())
+    {
+      for (const ImageData& image_data : std::as_const(image_data_))
+      {
+        const QFileInfo label_info(image_data.label_filename);
+        if (!image_data.label_filename.isEmpty() && removed_folders.contains(label_info.absolutePath()))
         {
-          qDebug() << "Found nan in " << label_filename;
+          changed_label_filenames.insert(label_info.fileName());
         }
+      }
+    }
+  }
 
-        if (fields.size() >= 5)
-        {
-          new_elem.annotations.push_back(fields);
+  images_changed_ = false;
+  annotation_folders_changed_ = false;
+  all_labels_changed_ = false;
+  changed_label_filenames_.clear();
 
-          const float rel_box_width = fields[3].toFloat();
-          const float rel_box_height = fields[4].toFloat();
+  const ImageFolderScanner scanner(current_image_folder_.absolutePath(), annotation_folders_);
 
-          new_elem.min_rel_objet_size = std::min(rel_box_width, std::min(rel_box_height, new_elem.min_rel_objet_size));
-          new_elem.max_rel_objet_size = std::max(rel_box_width, std::max(rel_box_height, new_elem.max_rel_objet_size));
+  int num_removed = 0;
+  int num_added = 0;
 
-          new_elem.label_ids.insert(fields[0].toInt());
-        }
+  if (images_changed)
+  {
+    const QStringList all_image_file_names =
+        current_image_folder_.entryList(image_filename_filter_, QDir::Filter::Files, QDir::Name);
+    const QSet<QString> existing_image_filenames(all_image_file_names.begin(), all_image_file_names.end());
+
+    // 1. Remove images that do not exist anymore (from the back, so that the rows stay valid)
+    for (int last = image_data_.size() - 1; last >= 0; last--)
+    {
+      if (existing_image_filenames.contains(image_data_.at(last).image_filename))
+      {
+        continue;
       }
 
-      file.close();
+      int first = last;
+      while (first > 0 && !existing_image_filenames.contains(image_data_.at(first - 1).image_filename))
+      {
+        first--;
+      }
+
+      this->beginRemoveRows(QModelIndex(), first, last);
+      image_data_.remove(first, last - first + 1);
+      rows_by_label_filename_outdated_ = true;
+      this->endRemoveRows();
+
+      num_removed += last - first + 1;
+      last = first;
     }
 
-    image_data_.push_back(new_elem);
+    // 2. Insert new images at their position in the folder order (with their current labels).
+    //    The remaining rows are in the same order as in all_image_file_names.
+    int row = 0;
+    for (int i = 0; i < all_image_file_names.size();)
+    {
+      if (row < image_data_.size() && image_data_.at(row).image_filename == all_image_file_names.at(i))
+      {
+        row++;
+        i++;
+        continue;
+      }
+
+      QStringList new_image_filenames;
+      while (i < all_image_file_names.size() &&
+             (row >= image_data_.size() || image_data_.at(row).image_filename != all_image_file_names.at(i)))
+      {
+        new_image_filenames.push_back(all_image_file_names.at(i));
+        i++;
+      }
+
+      const QList<ImageData> new_image_data = scanner.scan(new_image_filenames);
+
+      this->beginInsertRows(QModelIndex(), row, row + new_image_data.size() - 1);
+      for (int k = 0; k < new_image_data.size(); k++)
+      {
+        image_data_.insert(row + k, new_image_data.at(k));
+      }
+      rows_by_label_filename_outdated_ = true;
+      this->endInsertRows();
+
+      row += new_image_data.size();
+      num_added += new_image_data.size();
+    }
   }
 
-  qDebug() << "openFolder took " << timer.elapsed() << "ms";
+  // 3. Update the annotations of the images with added / removed / changed label files in the background.
+  //    The label files of the other images are not touched.
+  QList<int> label_rows;
+  if (all_labels_changed)
+  {
+    label_rows.resize(image_data_.size());
+    std::iota(label_rows.begin(), label_rows.end(), 0);
+  }
+  else if (!changed_label_filenames.isEmpty())
+  {
+    if (rows_by_label_filename_outdated_)
+    {
+      rows_by_label_filename_.clear();
+      for (int row = 0; row < image_data_.size(); row++)
+      {
+        rows_by_label_filename_.insert(AnnotationFolders::imageFilenameToLabelFilename(image_data_.at(row).image_filename), row);
+      }
+      rows_by_label_filename_outdated_ = false;
+    }
 
-  this->endResetModel();
+    for (const QString& label_filename : std::as_const(changed_label_filenames))
+    {
+      label_rows.append(rows_by_label_filename_.values(label_filename));
+    }
+  }
+
+  if (!label_rows.isEmpty())
+  {
+    updateAnnotations(scanner, label_rows);
+  }
+
+  updating_from_disk_ = false;
+
+  qDebug() << "updateFromDisk: " << num_added << " added, " << num_removed << " removed, " << label_rows.size()
+           << " label files to check, took " << timer.elapsed() << "ms";
 }
 
-void ImageListModel::setFolderMode(const Mode& folder_mode)
+void ImageListModel::updateAnnotations(const ImageFolderScanner& scanner, const QList<int>& rows)
 {
-  openFolder(opened_folder_, folder_mode);
+  // The workers get copies, the rows are only changed here (after checking that they still belong to the same image)
+  QList<ImageData> image_data;
+  image_data.reserve(rows.size());
+  for (const int row : rows)
+  {
+    image_data.push_back(image_data_.at(row));
+  }
+
+  auto cancelled = std::make_shared<std::atomic<bool>>(false);
+  label_update_cancelled_ = cancelled;
+  label_update_running_ = true;
+
+  QtConcurrent::mapped(image_data,
+                       [scanner, cancelled](ImageData image_data) -> std::optional<ImageData>
+                       {
+                         if (*cancelled || !scanner.updateAnnotations(image_data))
+                         {
+                           return std::nullopt;
+                         }
+                         return image_data;
+                       })
+      .then(this,
+            [this, rows, cancelled](QFuture<std::optional<ImageData>> future)
+            {
+              if (*cancelled)
+              {
+                return;
+              }
+
+              label_update_running_ = false;
+              updating_from_disk_ = true;
+
+              const QList<std::optional<ImageData>> updated_image_data = future.results();
+
+              int num_changed = 0;
+              for (int i = 0; i < updated_image_data.size(); i++)
+              {
+                const int row = rows.at(i);
+                if (!updated_image_data.at(i))
+                {
+                  continue;
+                }
+
+                // The image was removed in the meantime => check its label file again with the next update
+                if (row >= image_data_.size() || image_data_.at(row).image_filename != updated_image_data.at(i)->image_filename)
+                {
+                  changed_label_filenames_.insert(
+                      AnnotationFolders::imageFilenameToLabelFilename(updated_image_data.at(i)->image_filename));
+                  folder_update_timer_.start();
+                  continue;
+                }
+
+                image_data_[row] = updated_image_data.at(i).value();
+                emit dataChanged(this->index(row, 0), this->index(row, Columns::COUNT - 1));
+                num_changed++;
+              }
+
+              updating_from_disk_ = false;
+
+              qDebug() << "updateFromDisk: " << num_changed << " of " << rows.size() << " label files changed";
+            });
+}
+
+void ImageListModel::cancelLabelUpdate()
+{
+  if (label_update_cancelled_)
+  {
+    *label_update_cancelled_ = true;
+  }
+
+  label_update_running_ = false;
 }
 
 void ImageListModel::removeImage(const int image_idx)
@@ -157,11 +489,22 @@ void ImageListModel::removeImage(const int image_idx)
   emit layoutAboutToBeChanged();
 
   this->image_data_.remove(image_idx);
+  rows_by_label_filename_outdated_ = true;
   this->removeRow(image_idx);
 
   emit layoutChanged();
 }
 
+bool ImageListModel::isScanning() const
+{
+  return folder_scanner_.isRunning();
+}
+
+bool ImageListModel::isUpdatingFromDisk() const
+{
+  return updating_from_disk_;
+}
+
 int ImageListModel::rowCount(const QModelIndex& parent) const
 {
   return image_data_.size();
@@ -177,8 +520,10 @@ QImage ImageListModel::getPreviewImage(const int image_idx) const
   QImage preview_image;
 
   // 1. Load the preview image itself
-  const auto image_result =
-      cache_db_.getPreviewImage(image_data_.at(image_idx).md5_hash.toHex(), image_data_.at(image_idx).filesize);
+  const QString md5_hash = image_data_.at(image_idx).md5_hash.toHex();
+  const int filesize = image_data_.at(image_idx).filesize;
+
+  const auto image_result = cache_db_.getCachedPreviewImage(md5_hash, filesize);
 
   if (image_result)
   {
@@ -186,29 +531,119 @@ QImage ImageListModel::getPreviewImage(const int image_idx) const
   }
   else
   {
-    preview_image = QImage(current_image_folder_.absoluteFilePath(image_data_.at(image_idx).image_filename))
-                        .scaled(128, 128, Qt::KeepAspectRatio, Qt::FastTransformation)
-                        .convertToFormat(QImage::Format_RGB888);
+    const QString key = ThumbnailLoader::key(md5_hash, filesize);
+    const QPersistentModelIndex model_index = this->index(image_idx, Columns::IMAGE);
+
+    // Decode (or create) it in the background and show a placeholder until it is ready
+    if (!pending_preview_indices_.contains(key))
+    {
+      thumbnail_loader_.request(md5_hash,
+                                filesize,
+                                current_image_folder_.absoluteFilePath(image_data_.at(image_idx).image_filename),
+                                cache_db_.getEncodedPreviewImage(md5_hash, filesize));
+    }
+    if (!pending_preview_indices_.contains(key, model_index))
+    {
+      pending_preview_indices_.insert(key, model_index);
+    }
 
-    cache_db_.storePreviewImage(image_data_.at(image_idx).md5_hash.toHex(), image_data_.at(image_idx).filesize, preview_image);
+    static const QImage placeholder_image = []()
+    {
+      QImage image(128, 96, QImage::Format_RGB888);
+      image.fill(Qt::lightGray);
+      return image;
+    }();
+
+    return placeholder_image;
   }
 
   // 2. Add current annotated bounding boxes as overlay
   QPainter painter(&preview_image);
 
-  for (const QStringList& annotation_fields : image_data_.at(image_idx).annotations)
+  QPen pen;
+  std::optional<int> pen_label_id;
+
+  for (const ImageAnnotation& annotation : image_data_.at(image_idx).annotations)
   {
-    AnnotationBoundingBox bbox(annotation_fields, preview_image.size(), QStringList());
+    const QRectF bbox_rect = AnnotationStore::rectFromYolo(
+        annotation.x_center, annotation.y_center, annotation.width, annotation.height, preview_image.size());
+
+    if (pen_label_id != annotation.label_id)
+    {
+      pen.setColor(LabelColors::colorForLabelId(annotation.label_id));
+      painter.setPen(pen);
+      pen_label_id = annotation.label_id;
+    }
 
-    QPen pen;
-    pen.setColor(LabelColors::colorForLabelId(bbox.labelID()));
-    painter.setPen(pen);
-    painter.drawRect(bbox.rect());
+    painter.drawRect(bbox_rect.intersected(preview_image.rect()));
   }
 
   return preview_image;
 }
 
+void ImageListModel::setPreviewCacheBudget(const qsizetype preview_cache_budget)
+{
+  cache_db_.setPreviewCacheBudget(preview_cache_budget);
+}
+
+void ImageListModel::setPreviewCodec(const PreviewCodec codec)
+{
+  cache_db_.setPreviewCodec(codec);
+}
+
+void ImageListModel::cancelPreviewImagesExcept(const QList<int>& image_indices)
+{
+  QSet<QString> keys;
+  for (const int image_idx : image_indices)
+  {
+    if (image_idx >= 0 && image_idx < image_data_.size())
+    {
+      keys.insert(ThumbnailLoader::key(image_data_.at(image_idx).md5_hash.toHex(), image_data_.at(image_idx).filesize));
+    }
+  }
+
+  thumbnail_loader_.cancelAllExcept(keys);
+
+  for (auto it = pending_preview_indices_.begin(); it != pending_preview_indices_.end();)
+  {
+    if (keys.contains(it.key()))
+    {
+      it++;
+    }
+    else
+    {
+      it = pending_preview_indices_.erase(it);
+    }
+  }
+}
+
+void ImageListModel::prefetchFullResImages(const QList<int>& image_indices, const QSize& max_size)
+{
+  QStringList keys;
+  for (const int image_idx : image_indices)
+  {
+    if (image_idx >= 0 && image_idx < image_data_.size())
+    {
+      keys.push_back(getFullResImageKey(image_idx, max_size));
+    }
+  }
+
+  image_prefetcher_.cancelAllExcept(keys);
+
+  for (const int image_idx : image_indices)
+  {
+    if (image_idx >= 0 && image_idx < image_data_.size())
+    {
+      image_prefetcher_.prefetch(getFullImagePath(image_idx), image_data_.at(image_idx).image_mtime, max_size);
+    }
+  }
+}
+
+void ImageListModel::setFullResCacheBudget(const qsizetype full_res_cache_budget)
+{
+  image_prefetcher_.setCacheBudget(full_res_cache_budget);
+}
+
 QVariant ImageListModel::data(const QModelIndex& index, int role) const
 {
   // qDebug() << "ImageListModel::data(" << index.row() << "; " << index.column() << ")";
@@ -235,7 +670,7 @@ QVariant ImageListModel::data(const QModelIndex& index, int role) const
     {
       if (folder_mode_ == Mode::ANNOTATION)
       {
-        return current_image_folder_.absoluteFilePath(imageFilenameToLabelFilename(image_filename));
+        return current_image_folder_.absoluteFilePath(AnnotationFolders::imageFilenameToLabelFilename(image_filename));
       }
       else
       {
@@ -340,9 +775,24 @@ QString ImageListModel::getFullImagePath(const int image_idx) const
       this->data(this->index(image_idx, Columns::IMAGE_FILE_NAME), Qt::DisplayRole).value<QString>());
 }
 
-QImage ImageListModel::getFullResImage(const int image_idx) const
+std::optional<QImage> ImageListModel::requestFullResImage(const int image_idx, const QSize& max_size) const
 {
-  return this->data(this->index(image_idx, Columns::IMAGE), Qt::UserRole).value<QImage>();
+  if (image_idx < 0 || image_idx >= image_data_.size())
+  {
+    return QImage();
+  }
+
+  return image_prefetcher_.request(getFullImagePath(image_idx), image_data_.at(image_idx).image_mtime, max_size);
+}
+
+QString ImageListModel::getFullResImageKey(const int image_idx, const QSize& max_size) const
+{
+  if (image_idx < 0 || image_idx >= image_data_.size())
+  {
+    return QString();
+  }
+
+  return ImagePrefetcher::key(getFullImagePath(image_idx), image_data_.at(image_idx).image_mtime, max_size);
 }
 
 QString ImageListModel::getAnnotationInputFilename(const int image_idx) const
@@ -355,31 +805,14 @@ QString ImageListModel::getAnnotationOutputFilename(const int image_idx) const
   return this->data(this->index(image_idx, Columns::ANNOTATION_OUTPUT_FILENAME), Qt::DisplayRole).value<QString>();
 }
 
-QString ImageListModel::imageFilenameToLabelFilename(const QString& image_filename)
+const QList<ImageData>& ImageListModel::imageData() const
 {
-  return QFileInfo(image_filename).completeBaseName() + ".txt";
+  return image_data_;
 }
 
 QString ImageListModel::getLabelFilename(const QString& image_filename) const
 {
-  // Try primary labelfile
-  const QString label_filename = imageFilenameToLabelFilename(image_filename);
-
-  if (QFile(primary_annotations_folder_.absoluteFilePath(label_filename)).exists())
-  {
-    return primary_annotations_folder_.absoluteFilePath(label_filename);
-  }
-
-  for (const QDir& annotation_folder : secondary_annotations_folders_)
-  {
-    if (QFile(annotation_folder.absoluteFilePath(label_filename)).exists())
-    {
-      return annotation_folder.absoluteFilePath(label_filename);
-    }
-  }
-
-  // Fallback: No annotation file is available
-  return "";
+  return annotation_folders_.labelFilename(image_filename);
 }
 
 QDir& ImageListModel::currentImageFolder()
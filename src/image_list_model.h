@@ -3,23 +3,25 @@
 #include <QAbstractItemModel>
 #include <QDir>
 #include <QImage>
+#include <QMultiHash>
+#include <QSet>
+#include <QTimer>
 
-#include "annotationboundingbox.h"
-#include "cache_db_interface.h"
+#include <atomic>
+#include <memory>
+#include <optional>
 
-struct ImageData
-{
-  QString image_filename;
-  QByteArray md5_hash;
-  int filesize{0};
-  float min_rel_objet_size{std::numeric_limits<float>::infinity()};
-  float max_rel_objet_size{0.f};
-  QSet<int> label_ids;
-  QList<QStringList> annotations;
-};
+#include "annotation_store.h"
+#include "cache_db_interface.h"
+#include "folder_watcher.h"
+#include "image_folder_scanner.h"
+#include "image_prefetcher.h"
+#include "thumbnail_loader.h"
 
 class ImageListModel : public QAbstractListModel
 {
+  Q_OBJECT
+
 public:
   enum Columns
   {
@@ -42,7 +44,9 @@ public:
     REVIEW
   };
 
-  explicit ImageListModel(const QDir& root_path, QObject* parent = nullptr);
+  explicit ImageListModel(const QDir& root_path,
+                          const PreviewCacheBackend preview_cache_backend = PreviewCacheBackend::SQLITE,
+                          QObject* parent = nullptr);
 
   void openFolder(const QString& folder, const Mode& folder_mode);
 
@@ -50,30 +54,63 @@ public:
 
   void removeImage(const int image_idx);
 
+  // True while the rows of the opened folder are still being appended
+  bool isScanning() const;
+
+  // True while changes of the opened folder on disk are applied to the model
+  bool isUpdatingFromDisk() const;
+
   int rowCount(const QModelIndex& parent = QModelIndex()) const;
   int columnCount(const QModelIndex& parent = QModelIndex()) const;
 
+  // Returns a placeholder and creates the preview in the background, if it is not cached yet
   QImage getPreviewImage(const int image_idx) const;
 
+  // Max. number of bytes of preview images kept in memory
+  void setPreviewCacheBudget(const qsizetype preview_cache_budget);
+
+  // Codec of the previews stored in the cache database
+  void setPreviewCodec(const PreviewCodec codec);
+
+  // Only keep creating previews for these images (e.g. the ones visible in the grid view)
+  void cancelPreviewImagesExcept(const QList<int>& image_indices);
+
+  // Decodes these images (in this order) in the background, so that requestFullResImage() returns them right away.
+  // Prefetches of all other images are dropped. See requestFullResImage() for max_size.
+  void prefetchFullResImages(const QList<int>& image_indices, const QSize& max_size = QSize());
+
+  // Max. number of bytes of (prefetched) full resolution images kept in memory
+  void setFullResCacheBudget(const qsizetype full_res_cache_budget);
+
   QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
 
   QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
 
   QString getImageFilename(const int image_idx) const;
   QString getFullImagePath(const int image_idx) const;
-  QImage getFullResImage(const int image_idx) const;
+  // Returns the image if it is cached, otherwise it is decoded in the background and fullResImageReady() is emitted.
+  // If max_size is valid, the image is scaled to fit into it while it is decoded.
+  std::optional<QImage> requestFullResImage(const int image_idx, const QSize& max_size = QSize()) const;
+  // Identifies the image in fullResImageReady()
+  QString getFullResImageKey(const int image_idx, const QSize& max_size = QSize()) const;
   QString getAnnotationInputFilename(const int image_idx) const;
   QString getAnnotationOutputFilename(const int image_idx) const;
 
+  // All rows, e.g. for filtering them without going through data()
+  const QList<ImageData>& imageData() const;
+
   QDir& currentImageFolder();
 
   Mode currentFolderMode();
 
+signals:
+  // See requestFullResImage()
+  void fullResImageReady(const QString& key, const QImage& image);
+
 private:
   QString opened_folder_;
   QDir current_image_folder_;
-  QDir primary_annotations_folder_;
-  QList<QDir> secondary_annotations_folders_;
+  AnnotationFolders annotation_folders_;
   QList<ImageData> image_data_;
 
   Mode folder_mode_;
@@ -82,6 +119,38 @@ private:
 
   mutable CacheDBConnection cache_db_;
 
-  static QString imageFilenameToLabelFilename(const QString& image_filename);
+  mutable ThumbnailLoader thumbnail_loader_;
+  mutable QMultiHash<QString, QPersistentModelIndex> pending_preview_indices_;
+
+  mutable ImagePrefetcher image_prefetcher_;
+
+  AsyncImageFolderScanner folder_scanner_;
+
+  // Changes in the opened folders are collected for a moment and then applied at once
+  FolderWatcher folder_watcher_;
+  QTimer folder_update_timer_;
+  bool images_changed_{false};
+  bool annotation_folders_changed_{false};
+  bool all_labels_changed_{false};
+  // Names of the label files ("<image basename>.txt") that were added, removed or written in any watched folder
+  QSet<QString> changed_label_filenames_;
+  bool updating_from_disk_{false};
+
+  // Label file name -> rows of the images with that label file name, rebuilt after the rows changed
+  QMultiHash<QString, int> rows_by_label_filename_;
+  bool rows_by_label_filename_outdated_{true};
+
+  std::shared_ptr<std::atomic<bool>> label_update_cancelled_;
+  bool label_update_running_{false};
+
   QString getLabelFilename(const QString& image_filename) const;
+
+  // Sets the image folder and the folders to search for labels
+  void updateAnnotationFolders(const QString& folder, const Mode& folder_mode);
+
+  // Applies added / removed images and changed labels of the opened folder to the model
+  void updateFromDisk();
+  // Checks the label files of the rows in the background and applies the changed annotations
+  void updateAnnotations(const ImageFolderScanner& scanner, const QList<int>& rows);
+  void cancelLabelUpdate();
 };
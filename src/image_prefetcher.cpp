@@ -0,0 +1,195 @@
+#include <QImageReader>
+#include <QSet>
+#include <QThread>
+
+#include <algorithm>
+#include <utility>
+
+#include "image_prefetcher.h"
+
+ImagePrefetcher::ImagePrefetcher(QObject* parent)
+    : QObject(parent),
+      image_cache_(512 * 1024 * 1024)
+{
+  // Leave some threads for the previews of the grid view
+  thread_pool_.setMaxThreadCount(std::max(2, QThread::idealThreadCount() / 2));
+}
+
+ImagePrefetcher::~ImagePrefetcher()
+{
+  clear();
+  thread_pool_.waitForDone();
+}
+
+void ImagePrefetcher::setCacheBudget(const qsizetype cache_budget)
+{
+  image_cache_.setMaxCost(cache_budget);
+}
+
+void ImagePrefetcher::prefetch(const QString& image_path, const qint64 mtime, const QSize& max_size)
+{
+  const QString image_key = key(image_path, mtime, max_size);
+
+  if (image_cache_.contains(image_key) || prefetches_.contains(image_key))
+  {
+    return;
+  }
+
+  start(image_key, image_path, max_size, 0);
+}
+
+void ImagePrefetcher::cancelAllExcept(const QStringList& keys)
+{
+  const QSet<QString> keys_to_keep(keys.begin(), keys.end());
+
+  for (auto it = prefetches_.begin(); it != prefetches_.end();)
+  {
+    int expected_state = QUEUED;
+
+    // Running prefetches are finished anyway, so their result is kept
+    if (!keys_to_keep.contains(it.key()) && it.key() != requested_key_ &&
+        it.value()->compare_exchange_strong(expected_state, CANCELLED))
+    {
+      it = prefetches_.erase(it);
+    }
+    else
+    {
+      it++;
+    }
+  }
+}
+
+std::optional<QImage> ImagePrefetcher::request(const QString& image_path, const qint64 mtime, const QSize& max_size)
+{
+  const QString image_key = key(image_path, mtime, max_size);
+
+  if (const QImage* cached_image = image_cache_.object(image_key))
+  {
+    return *cached_image;
+  }
+
+  // The previously requested image is not shown anymore, when scrolling through the images only the last one counts
+  const QString previous_requested_key = std::exchange(requested_key_, image_key);
+  if (previous_requested_key != image_key)
+  {
+    const auto previous_request = prefetches_.find(previous_requested_key);
+    int expected_state = QUEUED;
+    if (previous_request != prefetches_.end() && previous_request.value()->compare_exchange_strong(expected_state, CANCELLED))
+    {
+      prefetches_.erase(previous_request);
+    }
+  }
+
+  const auto prefetch = prefetches_.find(image_key);
+  if (prefetch != prefetches_.end())
+  {
+    int expected_state = QUEUED;
+
+    // A running prefetch emits imageReady() anyway, a queued one would wait for the prefetches before it
+    if (!prefetch.value()->compare_exchange_strong(expected_state, CANCELLED))
+    {
+      return std::nullopt;
+    }
+
+    prefetches_.erase(prefetch);
+  }
+
+  start(image_key, image_path, max_size, 1);
+
+  return std::nullopt;
+}
+
+void ImagePrefetcher::clear()
+{
+  requested_key_.clear();
+  cancelAllExcept({});
+  prefetches_.clear();
+  image_cache_.clear();
+}
+
+QString ImagePrefetcher::key(const QString& image_path, const qint64 mtime, const QSize& max_size)
+{
+  QString image_key = image_path + ":" + QString::number(mtime);
+
+  if (max_size.isValid())
+  {
+    image_key += QString(":%1x%2").arg(max_size.width()).arg(max_size.height());
+  }
+
+  return image_key;
+}
+
+QImage ImagePrefetcher::decodeImage(const QString& image_path, const QSize& max_size)
+{
+  QImageReader image_reader(image_path);
+
+  const QSize image_size = image_reader.size();
+  if (max_size.isValid() && image_size.isValid())
+  {
+    image_reader.setScaledSize(image_size.scaled(max_size, Qt::KeepAspectRatio));
+  }
+
+  QImage image = image_reader.read();
+
+  // Fallback for formats that can not report their size upfront
+  if (max_size.isValid() && !image_size.isValid())
+  {
+    image = image.scaled(max_size, Qt::KeepAspectRatio);
+  }
+
+  // Formats that the raster paint engine draws without converting them first
+  if (image.hasAlphaChannel())
+  {
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+  }
+  else
+  {
+    return image.convertToFormat(QImage::Format_RGB32);
+  }
+}
+
+void ImagePrefetcher::start(const QString& image_key, const QString& image_path, const QSize& max_size, const int priority)
+{
+  auto state = std::make_shared<std::atomic<int>>(QUEUED);
+  prefetches_.insert(image_key, state);
+
+  thread_pool_.start(
+      [this, image_key, image_path, max_size, state]()
+      {
+        int expected_state = QUEUED;
+        if (!state->compare_exchange_strong(expected_state, RUNNING))
+        {
+          return;
+        }
+
+        const QImage image = decodeImage(image_path, max_size);
+
+        // The destructor waits for the thread pool, so this is still alive
+        QMetaObject::invokeMethod(
+            this,
+            [this, image_key, image, state]()
+            {
+              // The prefetches could have been cleared in the meantime (e.g. another folder was opened)
+              const auto prefetch = prefetches_.constFind(image_key);
+              if (prefetch == prefetches_.constEnd() || prefetch.value() != state)
+              {
+                return;
+              }
+
+              prefetches_.erase(prefetch);
+              insertIntoCache(image_key, image);
+
+              emit imageReady(image_key, image);
+            },
+            Qt::QueuedConnection);
+      },
+      priority);
+}
+
+void ImagePrefetcher::insertIntoCache(const QString& key, const QImage& image)
+{
+  if (!image.isNull())
+  {
+    image_cache_.insert(key, new QImage(image), image.sizeInBytes());
+  }
+}
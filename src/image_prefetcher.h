@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+
+// Decodes full resolution images on background threads before they are shown, e.g. the next images of the slider.
+// Ready-to-display images are kept in a memory budgeted LRU cache. Images are identified by path and mtime,
+// so a changed file is decoded again.
+class ImagePrefetcher : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit ImagePrefetcher(QObject* parent = nullptr);
+  ~ImagePrefetcher();
+
+  // Max. number of bytes of the decoded images kept in memory
+  void setCacheBudget(const qsizetype cache_budget);
+
+  // Decodes the image in the background, if it is neither cached nor already being decoded.
+  // Images are decoded in the order they are requested.
+  // If max_size is valid, the image is decoded at the size that fits into it.
+  void prefetch(const QString& image_path, const qint64 mtime, const QSize& max_size = QSize());
+
+  // Drops all prefetches that did not start yet, except for the given images (as returned by key()) and the requested one
+  void cancelAllExcept(const QStringList& keys);
+
+  // Returns the cached image. Otherwise the image is decoded in the background ahead of all prefetches (or the running
+  // prefetch of it is used) and imageReady() is emitted. Only the last requested image is kept in line.
+  std::optional<QImage> request(const QString& image_path, const qint64 mtime, const QSize& max_size = QSize());
+
+  void clear();
+
+  static QString key(const QString& image_path, const qint64 mtime, const QSize& max_size = QSize());
+
+  // Decodes into a format that can be drawn without another conversion.
+  // Scaling to max_size is done by the decoder (e.g. in the DCT domain for JPEG) where possible.
+  static QImage decodeImage(const QString& image_path, const QSize& max_size = QSize());
+
+signals:
+  // A prefetched or requested image was decoded (key() of the image)
+  void imageReady(const QString& key, const QImage& image);
+
+private:
+  enum State
+  {
+    QUEUED,
+    RUNNING,
+    CANCELLED
+  };
+
+  // Queues the decoding, requests have a higher priority than prefetches
+  void start(const QString& image_key, const QString& image_path, const QSize& max_size, const int priority);
+
+  void insertIntoCache(const QString& key, const QImage& image);
+
+  QThreadPool thread_pool_;
+
+  QCache<QString, QImage> image_cache_;
+  // The state of the images that are being decoded
+  QHash<QString, std::shared_ptr<std::atomic<int>>> prefetches_;
+  QString requested_key_;
+};
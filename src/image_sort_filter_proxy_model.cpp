@@ -5,6 +5,108 @@ ImageSortFilterProxy::ImageSortFilterProxy(QObject* parent)
     : QSortFilterProxyModel(parent)
 {
   this->setDynamicSortFilter(true);
+
+  // E.g. typing a filename pattern or spinning a spinbox only filters once
+  filter_timer_.setSingleShot(true);
+  filter_timer_.setInterval(150);
+
+  connect(&filter_timer_, &QTimer::timeout, this, &ImageSortFilterProxy::startFiltering);
+
+  // A pass waits for its chunks anyway, a cancelled one only runs until its next chunk
+  filter_thread_pool_.setMaxThreadCount(1);
+}
+
+ImageSortFilterProxy::~ImageSortFilterProxy()
+{
+  // Every pass (not only the latest one) uses this object when it finishes
+  cancelFiltering();
+  filter_thread_pool_.waitForDone();
+}
+
+void ImageSortFilterProxy::setSourceModel(QAbstractItemModel* source_model)
+{
+  if (image_list_model_)
+  {
+    disconnect(image_list_model_, nullptr, this, nullptr);
+  }
+
+  cancelFiltering();
+
+  image_list_model_ = dynamic_cast<ImageListModel*>(source_model);
+
+  // Connected before QSortFilterProxyModel connects to the source model,
+  // so that the filter columns are up to date when it calls filterAcceptsRow()
+  if (image_list_model_)
+  {
+    connect(image_list_model_, &QAbstractItemModel::modelReset, this, &ImageSortFilterProxy::resetFilterColumns);
+    connect(image_list_model_, &QAbstractItemModel::layoutChanged, this, &ImageSortFilterProxy::resetFilterColumns);
+
+    connect(image_list_model_,
+            &QAbstractItemModel::rowsInserted,
+            this,
+            [this](const QModelIndex& parent, int first, int last)
+            {
+              if (parent.isValid())
+              {
+                return;
+              }
+
+              // Appended rows do not make a running pass outdated, they are evaluated when it is applied
+              if (first != filter_columns_.size())
+              {
+                rows_revision_++;
+              }
+
+              filter_columns_.insertRows(image_list_model_->imageData(), first, last);
+              label_index_.insertRows(filter_columns_.label_ids, first, last);
+              filename_index_.insertRows(filter_columns_.image_filenames, first, last);
+              accepted_rows_.insert(accepted_rows_.begin() + first, last - first + 1, 0);
+              evaluateRows(first, last);
+            });
+
+    connect(image_list_model_,
+            &QAbstractItemModel::rowsRemoved,
+            this,
+            [this](const QModelIndex& parent, int first, int last)
+            {
+              if (parent.isValid())
+              {
+                return;
+              }
+
+              rows_revision_++;
+              filter_columns_.removeRows(first, last);
+              label_index_.removeRows(first, last);
+              filename_index_.removeRows(first, last);
+              accepted_rows_.erase(accepted_rows_.begin() + first, accepted_rows_.begin() + last + 1);
+            });
+
+    connect(image_list_model_,
+            &QAbstractItemModel::dataChanged,
+            this,
+            [this](const QModelIndex& top_left, const QModelIndex& bottom_right, const QList<int>& roles)
+            {
+              // E.g. a preview image that finished loading
+              if (!roles.isEmpty() && !roles.contains(Qt::DisplayRole))
+              {
+                return;
+              }
+
+              if (!top_left.isValid() || top_left.parent().isValid())
+              {
+                return;
+              }
+
+              rows_revision_++;
+              filter_columns_.updateRows(image_list_model_->imageData(), top_left.row(), bottom_right.row());
+              label_index_.updateRows(filter_columns_.label_ids, top_left.row(), bottom_right.row());
+              evaluateRows(top_left.row(), bottom_right.row());
+            });
+  }
+
+  resetFilterColumns();
+
+  QSortFilterProxyModel::setSourceModel(source_model);
 }
 
 int ImageSortFilterProxy::mapRowToSource(int row) const
@@ -14,106 +116,222 @@ int ImageSortFilterProxy::mapRowToSource(int row) const
 
 bool ImageSortFilterProxy::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const
 {
-  QModelIndex filename_index = sourceModel()->index(sourceRow, ImageListModel::Columns::IMAGE_FILE_NAME, sourceParent);
+  if (sourceParent.isValid() || sourceRow < 0 || sourceRow >= int(accepted_rows_.size()))
+  {
+    return !image_list_model_;
+  }
 
-  QString image_filename = sourceModel()->data(filename_index).toString();
-  const int num_objects =
-      sourceModel()->data(sourceModel()->index(sourceRow, ImageListModel::Columns::NUM_OBJECTS, sourceParent)).toInt();
-  const float min_rel_object_size =
-      sourceModel()->data(sourceModel()->index(sourceRow, ImageListModel::Columns::MIN_REL_OBJECT_SIZE, sourceParent)).toFloat();
-  const float max_rel_object_size =
-      sourceModel()->data(sourceModel()->index(sourceRow, ImageListModel::Columns::MAX_REL_OBJECT_SIZE, sourceParent)).toFloat();
-  const QList<QVariant> label_ids =
-      sourceModel()->data(sourceModel()->index(sourceRow, ImageListModel::Columns::LABEL_IDS, sourceParent)).toList();
+  return accepted_rows_[sourceRow];
+}
 
-  bool use_image = true;
+bool ImageSortFilterProxy::lessThan(const QModelIndex& source_left, const QModelIndex& source_right) const
+{
+  const int left = source_left.row();
+  const int right = source_right.row();
 
-  // Filter by filename
-  if (filter_by_filename_pattern_)
+  if (!image_list_model_ || sortRole() != Qt::DisplayRole || source_left.column() != source_right.column() ||
+      left < 0 || right < 0 || left >= filter_columns_.size() || right >= filter_columns_.size())
   {
-    use_image &= image_filename.contains(filter_by_filename_pattern_.value());
+    return QSortFilterProxyModel::lessThan(source_left, source_right);
   }
 
-  // Filter by rel. object size
-  if (filter_by_rel_object_size_)
+  switch (source_left.column())
   {
-    use_image &= min_rel_object_size >= filter_by_rel_object_size_.value().first;
-    use_image &= max_rel_object_size <= filter_by_rel_object_size_.value().second;
+    case ImageListModel::Columns::NUM_OBJECTS:
+      return filter_columns_.num_objects[left] < filter_columns_.num_objects[right];
+
+    case ImageListModel::Columns::MIN_REL_OBJECT_SIZE:
+      return filter_columns_.min_rel_object_sizes[left] < filter_columns_.min_rel_object_sizes[right];
+
+    case ImageListModel::Columns::MAX_REL_OBJECT_SIZE:
+      return filter_columns_.max_rel_object_sizes[left] < filter_columns_.max_rel_object_sizes[right];
 
-    if (filter_by_rel_object_size_.value().first > 0.f)
-    {
-      use_image &= num_objects > 0;
-    }
+    case ImageListModel::Columns::FILESIZE:
+      return filter_columns_.filesizes[left] < filter_columns_.filesizes[right];
+
+    default:
+      return QSortFilterProxyModel::lessThan(source_left, source_right);
+  }
+}
+
+void ImageSortFilterProxy::resetFilterColumns()
+{
+  rows_revision_++;
+
+  label_index_.reset();
+  filename_index_.reset();
+
+  if (!image_list_model_)
+  {
+    filter_columns_.reset({});
+    accepted_rows_.clear();
+    return;
   }
 
-  // Filter by num. objects
-  if (filter_by_num_objects_)
+  filter_columns_.reset(image_list_model_->imageData());
+  accepted_rows_.assign(filter_columns_.size(), 0);
+  evaluateRows(0, filter_columns_.size() - 1);
+}
+
+void ImageSortFilterProxy::evaluateRows(const int first, const int last)
+{
+  if (!image_list_model_ || first > last)
   {
-    use_image &= num_objects >= filter_by_num_objects_.value().first;
-    use_image &= num_objects <= filter_by_num_objects_.value().second;
+    return;
   }
 
-  // Filter by labels
-  if (filter_by_label_id_)
+  // Until a running pass is applied, changed rows are evaluated with the filter of the other rows.
+  // No index candidates: the indices may be outdated here and are only rebuilt by the passes.
+  applied_filter_.evaluateParallel(filter_columns_, ImageFilterCandidates(), first, last, accepted_rows_.data());
+}
+
+void ImageSortFilterProxy::startFiltering()
+{
+  cancelFiltering();
+
+  if (!image_list_model_)
   {
-    use_image &= label_ids.contains(QVariant(filter_by_label_id_.value()));
+    applied_filter_ = filter_;
+    this->invalidateRowsFilter();
+    return;
   }
 
-  return use_image;
+  // Every pass gets its own flag, so a superseded pass can not apply its result anymore
+  auto cancelled = std::make_shared<std::atomic<bool>>(false);
+  filter_cancelled_ = cancelled;
+
+  // The pass works on copies, the rows can change while it is running
+  const ImageFilter filter = filter_;
+  const ImageFilterColumns filter_columns = filter_columns_;
+  // Not const, the pass brings its copies of the indices up to date
+  LabelIndex label_index = label_index_;
+  FilenameIndex filename_index = filename_index_;
+  const quint64 rows_revision = rows_revision_;
+
+  filter_thread_pool_.start(
+      [this, filter, filter_columns, label_index, filename_index, rows_revision, cancelled]() mutable
+      {
+        // The indices are only brought up to date for the active filters, the whole table is queried once per pass
+        ImageFilterCandidates candidates;
+
+        if (filter.label_query)
+        {
+          label_index.update(filter_columns.label_ids);
+          candidates.label_rows = label_index.query(filter.label_query.value());
+        }
+
+        if (filter.filename_pattern)
+        {
+          filename_index.update(filter_columns.image_filenames);
+          candidates.filename_rows = filename_index.candidates(filter.filename_pattern.value());
+        }
+
+        std::vector<char> accepted_rows(filter_columns.size(), 0);
+        filter.evaluateParallel(filter_columns, candidates, 0, filter_columns.size() - 1, accepted_rows.data(), cancelled.get());
+
+        if (*cancelled)
+        {
+          return;
+        }
+
+        // Apply the result in the thread of this object, after checking that it is still wanted
+        QMetaObject::invokeMethod(
+            this,
+            [this, filter, accepted_rows, label_index, filename_index, rows_revision, cancelled]()
+            {
+              if (*cancelled)
+              {
+                return;
+              }
+
+              if (rows_revision != rows_revision_)
+              {
+                startFiltering();
+                return;
+              }
+
+              const int num_evaluated_rows = accepted_rows.size();
+
+              applied_filter_ = filter;
+              accepted_rows_ = accepted_rows;
+              accepted_rows_.resize(filter_columns_.size(), 0);
+              evaluateRows(num_evaluated_rows, filter_columns_.size() - 1);
+
+              // Keep the indices rebuilt by this pass (plus the rows appended in the meantime)
+              label_index_ = label_index;
+              filename_index_ = filename_index;
+              if (num_evaluated_rows < filter_columns_.size())
+              {
+                label_index_.insertRows(filter_columns_.label_ids, num_evaluated_rows, filter_columns_.size() - 1);
+                filename_index_.insertRows(filter_columns_.image_filenames, num_evaluated_rows, filter_columns_.size() - 1);
+              }
+
+              this->invalidateRowsFilter();
+            },
+            Qt::QueuedConnection);
+      });
+}
+
+void ImageSortFilterProxy::cancelFiltering()
+{
+  if (filter_cancelled_)
+  {
+    *filter_cancelled_ = true;
+  }
 }
 
-void ImageSortFilterProxy::setFilterByFilename(const QString& filename_pattern, const bool enabled)
+void ImageSortFilterProxy::setFilterByFilename(const FilenamePattern& filename_pattern, const bool enabled)
 {
   if (enabled)
   {
-    filter_by_filename_pattern_ = filename_pattern;
+    filter_.filename_pattern = filename_pattern;
   }
   else
   {
-    filter_by_filename_pattern_.reset();
+    filter_.filename_pattern.reset();
   }
 
-  this->invalidateRowsFilter();
+  filter_timer_.start();
 }
 
 void ImageSortFilterProxy::setFilterRelObjectSize(const float& min_object_size, const float& max_object_size, const bool enabled)
 {
   if (enabled)
   {
-    filter_by_rel_object_size_ = QPair<float, float>(min_object_size, max_object_size);
+    filter_.rel_object_size = QPair<float, float>(min_object_size, max_object_size);
   }
   else
   {
-    filter_by_rel_object_size_.reset();
+    filter_.rel_object_size.reset();
   }
 
-  this->invalidateRowsFilter();
+  filter_timer_.start();
 }
 
 void ImageSortFilterProxy::setFilterByNumObjects(const int& min_num_objects, const int& max_num_objects, const bool enabled)
 {
   if (enabled)
   {
-    filter_by_num_objects_ = QPair<int, int>(min_num_objects, max_num_objects);
+    filter_.num_objects = QPair<int, int>(min_num_objects, max_num_objects);
   }
   else
   {
-    filter_by_num_objects_.reset();
+    filter_.num_objects.reset();
   }
 
-  this->invalidateRowsFilter();
+  filter_timer_.start();
 }
 
-void ImageSortFilterProxy::setFilterByLabelId(const int& label_id, const bool enabled)
+void ImageSortFilterProxy::setFilterByLabels(const LabelQuery& label_query, const bool enabled)
 {
   if (enabled)
   {
-    filter_by_label_id_ = label_id;
+    filter_.label_query = label_query;
   }
   else
   {
-    filter_by_label_id_.reset();
+    filter_.label_query.reset();
   }
 
-  this->invalidateRowsFilter();
+  filter_timer_.start();
 }
@@ -1,24 +1,71 @@
 #pragma once
 
 #include <QSortFilterProxyModel>
+#include <QThreadPool>
+#include <QTimer>
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "image_filter.h"
+
+class ImageListModel;
+
+// Filters an ImageListModel by a typed, column-wise copy of its rows (see ImageFilterColumns).
+// The copy follows the row changes of the source model, filterAcceptsRow() only looks up the filter results.
+// Filter changes are collected for a moment and then evaluated for all rows in the background
+// (a pass that is superseded by newer filter changes is cancelled).
 class ImageSortFilterProxy : public QSortFilterProxyModel
 {
 public:
   ImageSortFilterProxy(QObject* parent = nullptr);
+  ~ImageSortFilterProxy();
 
-  void setFilterByFilename(const QString& filename_pattern, const bool enabled);
+  void setSourceModel(QAbstractItemModel* source_model) override;
+
+  void setFilterByFilename(const FilenamePattern& filename_pattern, const bool enabled);
   void setFilterRelObjectSize(const float& min_object_size, const float& max_object_size, const bool enabled);
   void setFilterByNumObjects(const int& min_num_objects, const int& max_num_objects, const bool enabled);
-  void setFilterByLabelId(const int& label_id, const bool enabled);
+  // E.g. "has 2 AND NOT 5", see LabelQuery
+  void setFilterByLabels(const LabelQuery& label_query, const bool enabled);
 
   int mapRowToSource(int row) const;
 
   bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const;
 
+  // The numeric columns are compared by their typed values in the filter columns,
+  // the other ones by the QVariants of the source model
+  bool lessThan(const QModelIndex& source_left, const QModelIndex& source_right) const override;
+
 private:
-  std::optional<QString> filter_by_filename_pattern_;
-  std::optional<QPair<float, float>> filter_by_rel_object_size_;
-  std::optional<QPair<int, int>> filter_by_num_objects_;
-  std::optional<int> filter_by_label_id_;
+  ImageListModel* image_list_model_{nullptr};
+
+  // The filter set by the setters and the one accepted_rows_ were evaluated with
+  ImageFilter filter_;
+  ImageFilter applied_filter_;
+
+  ImageFilterColumns filter_columns_;
+  // Follow the filter columns, but are only rebuilt (after rows were inserted / removed in the middle) by the passes
+  LabelIndex label_index_;
+  FilenameIndex filename_index_;
+
+  // Filter result by source row
+  std::vector<char> accepted_rows_;
+
+  QTimer filter_timer_;
+  // Runs the passes (the chunks of a pass run on the global pool), also superseded ones until they noticed their flag
+  QThreadPool filter_thread_pool_;
+  std::shared_ptr<std::atomic<bool>> filter_cancelled_;
+
+  // Changes whenever existing rows of the source model change, a pass over outdated rows is repeated
+  quint64 rows_revision_{0};
+
+  void resetFilterColumns();
+  // Tests the rows one by one with applied_filter_, for the few rows that changed between the passes
+  void evaluateRows(const int first, const int last);
+
+  // Evaluates filter_ for all rows in the background and applies the result
+  void startFiltering();
+  void cancelFiltering();
 };
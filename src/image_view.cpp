@@ -2,7 +2,9 @@
 #include <QMouseEvent>
 #include <QPointF>
 
+#include "image_item.h"
 #include "image_view.h"
+#include "tiled_image_item.h"
 
 ImageView::ImageView(QWidget* parent)
     : QGraphicsView(parent)
@@ -31,8 +33,16 @@ void ImageView::setImage(const QImage& image, const bool fit_view)
   annotation_manager_->clear();
   this->clear();
 
-  image_item_ = new QGraphicsPixmapItem();
-  image_item_->setPixmap(QPixmap::fromImage(image));
+  image_size_ = image.size();
+
+  if (qint64(image.width()) * image.height() >= tiled_image_min_pixels)
+  {
+    image_item_ = new TiledImageItem(image);
+  }
+  else
+  {
+    image_item_ = new ImageItem(image);
+  }
 
   scene()->addItem(image_item_);
 
@@ -69,6 +79,19 @@ void ImageView::setImage(const QImage& image, const bool fit_view)
 
   edit_bbox_id_.reset();
   annotation_manager_->unselect();
+
+  image_changed_ = true;
+}
+
+void ImageView::paintEvent(QPaintEvent* event)
+{
+  QGraphicsView::paintEvent(event);
+
+  if (image_changed_)
+  {
+    image_changed_ = false;
+    emit imagePainted();
+  }
 }
 
 void ImageView::fitViewToImage()
@@ -208,7 +231,9 @@ bool ImageView::viewportEvent(QEvent* event)
   {
     if (bbox_edit_mode_ == BoundingBoxEditMode::New)
     {
-      if (annotation_manager_->latest()->rect().width() <= 1 || annotation_manager_->latest()->rect().height() <= 1)
+      const QRectF new_bbox_rect = annotation_manager_->boundingBoxRect(annotation_manager_->rowCount() - 1);
+
+      if (new_bbox_rect.width() <= 1 || new_bbox_rect.height() <= 1)
       {
         annotation_manager_->removeLatest();
       }
@@ -251,10 +276,10 @@ void ImageView::mousePressEvent(QMouseEvent* event)
 
         bbox_edit_mode_ = BoundingBoxEditMode::New;
 
-        annotation_manager_->add(new AnnotationBoundingBox(QRectF(cursor_position, QSizeF(0, 0)),
-                                                           annotation_manager_->activeLabel(),
-                                                           QSize(image_item_->pixmap().size()),
-                                                           *label_names_));
+        annotation_manager_->add(QRectF(cursor_position, QSizeF(0, 0)), annotation_manager_->activeLabel());
+
+        // The new box is under the cursor while it is drawn
+        annotation_manager_->setHoveredBoundingBox(annotation_manager_->rowCount() - 1);
 
         current_start_point_ = cursor_position;
       }
@@ -264,13 +289,13 @@ void ImageView::mousePressEvent(QMouseEvent* event)
         edit_bbox_id_ = bbox_part_under_cursor->first;
         edit_bbox_part_ = bbox_part_under_cursor->second;
 
-        AnnotationBoundingBox* edit_bbox = annotation_manager_->getAnnotationBoundingBox(*edit_bbox_id_);
+        const QRectF edit_bbox_rect = annotation_manager_->boundingBoxRect(*edit_bbox_id_);
 
         switch (bbox_part_under_cursor->second)
         {
         case BoundingBoxPart::CentralArea:
           bbox_edit_mode_ = BoundingBoxEditMode::DragFullBox;
-          edit_bbox_offset_ = cursor_position - edit_bbox->rect().center();
+          edit_bbox_offset_ = cursor_position - edit_bbox_rect.center();
 
           // Unselect previous BBox
           annotation_manager_->unselect();
@@ -287,19 +312,19 @@ void ImageView::mousePressEvent(QMouseEvent* event)
           switch (edit_bbox_part_)
           {
           case BoundingBoxPart::CornerUpperLeft:
-            edit_bbox_static_opposite_point_ = edit_bbox->rect().bottomRight();
+            edit_bbox_static_opposite_point_ = edit_bbox_rect.bottomRight();
             break;
 
           case BoundingBoxPart::CornerUpperRight:
-            edit_bbox_static_opposite_point_ = edit_bbox->rect().bottomLeft();
+            edit_bbox_static_opposite_point_ = edit_bbox_rect.bottomLeft();
             break;
 
           case BoundingBoxPart::CornerLowerRight:
-            edit_bbox_static_opposite_point_ = edit_bbox->rect().topLeft();
+            edit_bbox_static_opposite_point_ = edit_bbox_rect.topLeft();
             break;
 
           case BoundingBoxPart::CornerLowerLeft:
-            edit_bbox_static_opposite_point_ = edit_bbox->rect().topRight();
+            edit_bbox_static_opposite_point_ = edit_bbox_rect.topRight();
             break;
           }
           break;
@@ -345,6 +370,13 @@ void ImageView::mouseMoveEvent(QMouseEvent* event)
 
     auto bbox_under_cursor = annotation_manager_->getBoundingBoxPartUnderCursor(cursor_position);
 
+    // The hovered box is shown by an interactive item
+    if (bbox_edit_mode_ == BoundingBoxEditMode::None)
+    {
+      annotation_manager_->setHoveredBoundingBox(bbox_under_cursor ? std::optional<int>(bbox_under_cursor->first)
+                                                                   : std::optional<int>());
+    }
+
     if (bbox_under_cursor)
     {
       switch (bbox_under_cursor->second)
@@ -388,7 +420,11 @@ void ImageView::mouseMoveEvent(QMouseEvent* event)
       h_line_item_->show();
     }
 
-    AnnotationBoundingBox* edit_bbox = annotation_manager_->getAnnotationBoundingBox(*edit_bbox_id_);
+    QRectF edit_bbox_rect;
+    if (edit_bbox_id_)
+    {
+      edit_bbox_rect = annotation_manager_->boundingBoxRect(*edit_bbox_id_);
+    }
 
     switch (bbox_edit_mode_)
     {
@@ -398,11 +434,12 @@ void ImageView::mouseMoveEvent(QMouseEvent* event)
         current_start_point_ = cursor_position;
       }
 
-      annotation_manager_->latest()->setCornerPoints(*current_start_point_, cursor_position);
+      annotation_manager_->setBoundingBoxRect(annotation_manager_->rowCount() - 1,
+                                              QRectF(*current_start_point_, cursor_position).normalized());
       break;
 
     case BoundingBoxEditMode::DragFullBox:
-      edit_bbox->setCenter(cursor_position - edit_bbox_offset_);
+      edit_bbox_rect.moveCenter(cursor_position - edit_bbox_offset_);
       this->setCursor(QCursor(Qt::SizeAllCursor));
       break;
 
@@ -410,27 +447,33 @@ void ImageView::mouseMoveEvent(QMouseEvent* event)
       switch (edit_bbox_part_)
       {
       case BoundingBoxPart::EdgeLeft:
-        edit_bbox->setXMin(cursor_position.x());
+        edit_bbox_rect.setLeft(cursor_position.x());
         break;
 
       case BoundingBoxPart::EdgeRight:
-        edit_bbox->setXMax(cursor_position.x());
+        edit_bbox_rect.setRight(cursor_position.x());
         break;
 
       case BoundingBoxPart::EdgeTop:
-        edit_bbox->setYMin(cursor_position.y());
+        edit_bbox_rect.setTop(cursor_position.y());
         break;
 
       case BoundingBoxPart::EdgeBottom:
-        edit_bbox->setYMax(cursor_position.y());
+        edit_bbox_rect.setBottom(cursor_position.y());
         break;
       }
       break;
 
     case BoundingBoxEditMode::DragCorner:
-      edit_bbox->setCornerPoints(edit_bbox_static_opposite_point_, cursor_position);
+      edit_bbox_rect = QRectF(edit_bbox_static_opposite_point_, cursor_position);
       break;
     }
+
+    if (edit_bbox_id_ && bbox_edit_mode_ != BoundingBoxEditMode::None && bbox_edit_mode_ != BoundingBoxEditMode::New)
+    {
+      // Dragging an edge over the opposite one flips the box
+      annotation_manager_->setBoundingBoxRect(*edit_bbox_id_, edit_bbox_rect.normalized());
+    }
   }
 
   QGraphicsView::mouseMoveEvent(event);
@@ -46,6 +46,11 @@ public:
 
   void setEditingMode(const bool enabled);
 
+  void paintEvent(QPaintEvent* event) override;
+
+  // Images with more pixels are drawn by a TiledImageItem
+  static constexpr qint64 tiled_image_min_pixels = 16 * 1024 * 1024;
+
 private:
   AnnotationManager* annotation_manager_{nullptr};
 
@@ -54,7 +59,9 @@ private:
   TouchMode touch_mode_{TouchMode::None};
   std::optional<QPointF> current_start_point_;
 
-  QGraphicsPixmapItem* image_item_{nullptr};
+  // A TiledImageItem for large images, an ImageItem otherwise
+  QGraphicsItem* image_item_{nullptr};
+  QSize image_size_;
   QGraphicsLineItem* v_line_item_{nullptr};
   QGraphicsLineItem* h_line_item_{nullptr};
 
@@ -67,4 +74,11 @@ private:
   QStringList* label_names_{nullptr};
 
   bool editing_enabled_{true};
+
+  // True until the image of the last setImage() was painted
+  bool image_changed_{false};
+
+signals:
+  // Emitted after the first paint of a new image
+  void imagePainted();
 };
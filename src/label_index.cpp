@@ -0,0 +1,214 @@
+#include <algorithm>
+
+#include "label_index.h"
+
+bool LabelQuery::matches(const QSet<int>& label_ids) const
+{
+  if (!any_of.isEmpty() && !label_ids.intersects(any_of))
+  {
+    return false;
+  }
+
+  for (const int label_id : all_of)
+  {
+    if (!label_ids.contains(label_id))
+    {
+      return false;
+    }
+  }
+
+  return !label_ids.intersects(none_of);
+}
+
+std::optional<LabelQuery> LabelQuery::fromString(const QString& text, const QStringList& label_names, QString* error)
+{
+  const auto fail = [error](const QString& message) -> std::optional<LabelQuery>
+  {
+    if (error)
+    {
+      *error = message;
+    }
+    return std::nullopt;
+  };
+
+  // A label name or id
+  const auto labelID = [&label_names](const QString& label) -> std::optional<int>
+  {
+    const int label_id = label_names.indexOf(label);
+    if (label_id >= 0)
+    {
+      return label_id;
+    }
+
+    bool ok = false;
+    const int number = label.toInt(&ok);
+    return ok && number >= 0 ? std::optional<int>(number) : std::nullopt;
+  };
+
+  LabelQuery query;
+
+  for (const QString& term : text.split(',', Qt::SkipEmptyParts))
+  {
+    const QString condition = term.trimmed();
+
+    if (condition.isEmpty())
+    {
+      continue;
+    }
+
+    if (condition.startsWith('!'))
+    {
+      const std::optional<int> label_id = labelID(condition.mid(1).trimmed());
+      if (!label_id)
+      {
+        return fail(QString("Unknown label \"%1\"").arg(condition.mid(1).trimmed()));
+      }
+      query.none_of.insert(label_id.value());
+    }
+    else if (condition.contains('|'))
+    {
+      if (!query.any_of.isEmpty())
+      {
+        return fail("Only one \"|\" condition is supported");
+      }
+
+      for (const QString& alternative : condition.split('|', Qt::SkipEmptyParts))
+      {
+        const std::optional<int> label_id = labelID(alternative.trimmed());
+        if (!label_id)
+        {
+          return fail(QString("Unknown label \"%1\"").arg(alternative.trimmed()));
+        }
+        query.any_of.insert(label_id.value());
+      }
+    }
+    else
+    {
+      const std::optional<int> label_id = labelID(condition);
+      if (!label_id)
+      {
+        return fail(QString("Unknown label \"%1\"").arg(condition));
+      }
+      query.all_of.insert(label_id.value());
+    }
+  }
+
+  return query;
+}
+
+void LabelIndex::reset()
+{
+  rows_by_label_id_.clear();
+  num_rows_ = 0;
+  outdated_ = true;
+}
+
+void LabelIndex::insertRows(const QList<QSet<int>>& label_ids, const int first, const int last)
+{
+  if (outdated_ || first != num_rows_)
+  {
+    outdated_ = true;
+    return;
+  }
+
+  addRows(label_ids, first, last);
+}
+
+void LabelIndex::removeRows(const int first, const int last)
+{
+  Q_UNUSED(first);
+  Q_UNUSED(last);
+
+  outdated_ = true;
+}
+
+void LabelIndex::updateRows(const QList<QSet<int>>& label_ids, const int first, const int last)
+{
+  if (outdated_)
+  {
+    return;
+  }
+
+  for (int row = first; row <= last; row++)
+  {
+    for (auto rows = rows_by_label_id_.begin(); rows != rows_by_label_id_.end(); rows++)
+    {
+      rows.value().remove(row);
+    }
+
+    for (const int label_id : label_ids.at(row))
+    {
+      rows_by_label_id_[label_id].add(row);
+    }
+  }
+}
+
+void LabelIndex::update(const QList<QSet<int>>& label_ids)
+{
+  if (!outdated_ && num_rows_ == label_ids.size())
+  {
+    return;
+  }
+
+  rows_by_label_id_.clear();
+  num_rows_ = 0;
+  outdated_ = false;
+
+  addRows(label_ids, 0, label_ids.size() - 1);
+}
+
+RowBitmap LabelIndex::query(const LabelQuery& query) const
+{
+  RowBitmap result;
+
+  if (query.any_of.isEmpty())
+  {
+    result = RowBitmap::range(0, num_rows_ - 1);
+  }
+  else
+  {
+    for (const int label_id : query.any_of)
+    {
+      const auto rows = rows_by_label_id_.constFind(label_id);
+      if (rows != rows_by_label_id_.cend())
+      {
+        result |= rows.value();
+      }
+    }
+  }
+
+  for (const int label_id : query.all_of)
+  {
+    const auto rows = rows_by_label_id_.constFind(label_id);
+    if (rows == rows_by_label_id_.cend())
+    {
+      return RowBitmap();
+    }
+
+    result &= rows.value();
+  }
+
+  for (const int label_id : query.none_of)
+  {
+    const auto rows = rows_by_label_id_.constFind(label_id);
+    if (rows != rows_by_label_id_.cend())
+    {
+      result -= rows.value();
+    }
+  }
+
+  return result;
+}
+
+void LabelIndex::addRows(const QList<QSet<int>>& label_ids, const int first, const int last)
+{
+  for (int row = first; row <= last; row++)
+  {
+    for (const int label_id : label_ids.at(row))
+    {
+      rows_by_label_id_[label_id].add(row);
+    }
+  }
+
+  num_rows_ += std::max(last - first + 1, 0);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#include <optional>
+
+#include "row_bitmap.h"
+
+// Boolean query over the label ids of an image, e.g. "has 2 AND NOT 5" is {all_of: {2}, none_of: {5}}
+// and "any of {0, 3}" is {any_of: {0, 3}}. Empty sets do not restrict the result.
+struct LabelQuery
+{
+  QSet<int> all_of;
+  QSet<int> any_of;
+  QSet<int> none_of;
+
+  // For single rows, without an index
+  bool matches(const QSet<int>& label_ids) const;
+
+  // Parses comma separated conditions: "car" (has car), "!person" (has no person), "bus|truck" (has a bus or a truck).
+  // Labels are given by name or id. Nothing (and the reason in error) for unknown labels or more than one "|" condition.
+  static std::optional<LabelQuery> fromString(const QString& text, const QStringList& label_names, QString* error = nullptr);
+};
+
+// Inverted index from label id to the rows of the images with that label.
+// The rows are the elements of a label_ids column (see ImageFilterColumns).
+class LabelIndex
+{
+public:
+  // Empties the index, it is built by the next update()
+  void reset();
+
+  // The rows first..last were inserted into label_ids
+  void insertRows(const QList<QSet<int>>& label_ids, const int first, const int last);
+  // The rows first..last were removed from label_ids
+  void removeRows(const int first, const int last);
+  // The label ids of the rows first..last were changed
+  void updateRows(const QList<QSet<int>>& label_ids, const int first, const int last);
+
+  // Inserting / removing rows in the middle shifts all following rows, the index is then rebuilt here.
+  // Can take a while, so it is called on a copy in the background (see ImageSortFilterProxy).
+  void update(const QList<QSet<int>>& label_ids);
+
+  // The rows that match the query, the index has to be up to date (see update())
+  RowBitmap query(const LabelQuery& query) const;
+
+private:
+  QHash<int, RowBitmap> rows_by_label_id_;
+  int num_rows_{0};
+  bool outdated_{true};
+
+  void addRows(const QList<QSet<int>>& label_ids, const int first, const int last);
+};
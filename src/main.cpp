@@ -12,12 +12,20 @@ int main(int argc, char* argv[])
   parser.addPositionalArgument("root_path", "The root folder");
   parser.addPositionalArgument("label_names", "The label names...");
 
+  const QCommandLineOption preview_cache_backend_option(
+      "preview-cache-backend", "Where the preview images are cached: sqlite (default) or atlas", "backend", "sqlite");
+  parser.addOption(preview_cache_backend_option);
+
   parser.process(app);
 
+  const PreviewCacheBackend preview_cache_backend = parser.value(preview_cache_backend_option) == "atlas"
+                                                        ? PreviewCacheBackend::ATLAS
+                                                        : PreviewCacheBackend::SQLITE;
+
   QStringList label_names = parser.positionalArguments();
   label_names.pop_front(); // Remove the root_path
 
-  MainWindow mainWindow(parser.positionalArguments().at(0), label_names);
+  MainWindow mainWindow(parser.positionalArguments().at(0), label_names, preview_cache_backend);
   mainWindow.show();
   return app.exec();
 }
@@ -1,20 +1,37 @@
 #include <QFileIconProvider>
 #include <QGraphicsPixmapItem>
+#include <QLineEdit>
 #include <QProcess>
 #include <QRandomGenerator>
+#include <QScrollBar>
+#include <QStatusBar>
 
 #include <memory>
+#include <optional>
 
 #include "annotationboundingbox.h"
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
-MainWindow::MainWindow(const QString& root_path, const QStringList& label_names, QWidget* parent)
+namespace
+{
+// Marks the input of a filter that can not be applied (red, with the reason as tool tip)
+void setFilterInputError(QLineEdit* edit, const QString& error)
+{
+  edit->setStyleSheet(error.isEmpty() ? QString() : "QLineEdit { color: red; }");
+  edit->setToolTip(error);
+}
+} // namespace
+
+MainWindow::MainWindow(const QString& root_path,
+                       const QStringList& label_names,
+                       const PreviewCacheBackend preview_cache_backend,
+                       QWidget* parent)
     : QMainWindow(parent),
       ui(new Ui::MainWindow),
       root_path_(root_path),
       label_names_(label_names),
-      image_list_model_(new ImageListModel(root_path_, this)),
+      image_list_model_(new ImageListModel(root_path_, preview_cache_backend, this)),
       image_sort_filter_proxy_model_(new ImageSortFilterProxy(this))
 
 {
@@ -27,6 +44,10 @@ MainWindow::MainWindow(const QString& root_path, const QStringList& label_names,
   ui->image_view->setScene(scene_);
   ui->image_view->setInteractive(true);
 
+  statusBar()->addPermanentWidget(image_load_time_label_);
+  connect(ui->image_view, &ImageView::imagePainted, this, &MainWindow::onImagePainted);
+  connect(image_list_model_, &ImageListModel::fullResImageReady, this, &MainWindow::onFullResImageReady);
+
   // QFileIconProvider iconProvider;
   // folder_tree_model_.setIconProvider(&iconProvider);
   folder_tree_model_.setRootPath(root_path_);
@@ -52,6 +73,10 @@ MainWindow::MainWindow(const QString& root_path, const QStringList& label_names,
     ui->filter_by_label_combobox->addItem(label_name);
   }
 
+  image_list_model_->setPreviewCacheBudget(settings_.value("cache/preview_cache_budget_mb", 128).toLongLong() * 1024 * 1024);
+  image_list_model_->setPreviewCodec(PreviewImageCodec::codecFromName(settings_.value("cache/preview_codec", "qoi").toString()));
+  image_list_model_->setFullResCacheBudget(settings_.value("cache/full_res_cache_budget_mb", 512).toLongLong() * 1024 * 1024);
+
   image_sort_filter_proxy_model_->setSourceModel(image_list_model_);
 
   ui->image_grid_view->setResizeMode(QListView::Adjust);
@@ -59,6 +84,8 @@ MainWindow::MainWindow(const QString& root_path, const QStringList& label_names,
   ui->image_grid_view->setViewMode(QListView::ViewMode::IconMode);
   ui->image_grid_view->setModel(image_sort_filter_proxy_model_);
 
+  connect(ui->image_grid_view->verticalScrollBar(), &QScrollBar::valueChanged, this, &MainWindow::onImageGridScrolled);
+
   ui->images_table_view->setModel(image_sort_filter_proxy_model_);
   ui->images_table_view->horizontalHeader()->show();
   ui->images_table_view->verticalHeader()->show();
@@ -96,8 +123,10 @@ MainWindow::MainWindow(const QString& root_path, const QStringList& label_names,
   connect(ui->max_rel_bbox_size, SIGNAL(valueChanged(double)), this, SLOT(onUpdateFiltering()));
   connect(ui->filter_by_label, SIGNAL(toggled(bool)), this, SLOT(onUpdateFiltering()));
   connect(ui->filter_by_label_combobox, SIGNAL(currentIndexChanged(int)), this, SLOT(onUpdateFiltering()));
+  connect(ui->filter_by_label_query, SIGNAL(textChanged(QString)), this, SLOT(onUpdateFiltering()));
   connect(ui->filter_by_filename, SIGNAL(toggled(bool)), this, SLOT(onUpdateFiltering()));
   connect(ui->filter_by_filename_edit, SIGNAL(textChanged(QString)), this, SLOT(onUpdateFiltering()));
+  connect(ui->filter_by_filename_syntax, SIGNAL(currentIndexChanged(int)), this, SLOT(onUpdateFiltering()));
 
   connect(this->image_list_model_, SIGNAL(modelReset()), this, SLOT(onImageListModelReset()));
 
@@ -129,9 +158,9 @@ MainWindow::MainWindow(const QString& root_path, const QStringList& label_names,
   next_image_shortcut_.setAutoRepeat(true);
   next_image_shortcut_.setContext(Qt::ShortcutContext::ApplicationShortcut);
 
-  connect(this->image_sort_filter_proxy_model_, &ImageSortFilterProxy::rowsRemoved, [this]() { this->onImageListModelReset(); });
+  connect(this->image_sort_filter_proxy_model_, &ImageSortFilterProxy::rowsRemoved, this, &MainWindow::onImageListRowsRemoved);
 
-  connect(this->image_sort_filter_proxy_model_, &ImageSortFilterProxy::rowsInserted, [this]() { this->onImageListModelReset(); });
+  connect(this->image_sort_filter_proxy_model_, &ImageSortFilterProxy::rowsInserted, this, &MainWindow::onImageListRowsInserted);
 
   connect(ui->fit_view_button,
           &QPushButton::clicked,
@@ -194,6 +223,103 @@ void MainWindow::onImageListModelReset()
   }
 }
 
+void MainWindow::onImageListRowsInserted(const QModelIndex& parent, int first, int last)
+{
+  // While a folder is scanned (or updated from disk), rows are added in batches.
+  // Only the first batch loads an image, the following ones must not interrupt the current annotation.
+  if ((image_list_model_->isScanning() || image_list_model_->isUpdatingFromDisk()) &&
+      image_sort_filter_proxy_model_->rowCount() > last - first + 1)
+  {
+    ui->image_slider->setMaximum(image_sort_filter_proxy_model_->rowCount());
+
+    // Stay at the current image
+    if (first < ui->image_slider->value())
+    {
+      const QSignalBlocker blocker(ui->image_slider);
+      ui->image_slider->setValue(ui->image_slider->value() + last - first + 1);
+    }
+    return;
+  }
+
+  onImageListModelReset();
+}
+
+void MainWindow::onImageListRowsRemoved(const QModelIndex& parent, int first, int last)
+{
+  // Images that were removed on disk only interrupt the annotation if the current image is gone
+  const int current_row = ui->image_slider->value() - 1;
+
+  if (image_list_model_->isUpdatingFromDisk() && (current_row < first || current_row > last))
+  {
+    if (last < current_row)
+    {
+      const QSignalBlocker blocker(ui->image_slider);
+      ui->image_slider->setValue(ui->image_slider->value() - (last - first + 1));
+    }
+
+    ui->image_slider->setMaximum(image_sort_filter_proxy_model_->rowCount());
+    return;
+  }
+
+  onImageListModelReset();
+}
+
+void MainWindow::onImageGridScrolled()
+{
+  const QListView* grid_view = ui->image_grid_view;
+  const int num_rows = image_sort_filter_proxy_model_->rowCount();
+  const int viewport_height = grid_view->viewport()->height();
+
+  if (num_rows == 0)
+  {
+    return;
+  }
+
+  // The items are laid out line by line, so the tops of their rects never decrease with the row
+  // => Binary search for the first item that starts at or below y
+  const auto firstRowStartingAt = [this, grid_view, num_rows](const int y)
+  {
+    int low = 0;
+    int high = num_rows;
+    while (low < high)
+    {
+      const int mid = (low + high) / 2;
+      if (grid_view->visualRect(image_sort_filter_proxy_model_->index(mid, 0)).top() < y)
+      {
+        low = mid + 1;
+      }
+      else
+      {
+        high = mid;
+      }
+    }
+    return low;
+  };
+
+  int first_row = firstRowStartingAt(0);
+  const int last_row = firstRowStartingAt(viewport_height) - 1;
+
+  // Items of the line above that reach into the viewport
+  while (first_row > 0 && grid_view->visualRect(image_sort_filter_proxy_model_->index(first_row - 1, 0)).bottom() >= 0)
+  {
+    first_row--;
+  }
+
+  if (last_row < first_row)
+  {
+    return;
+  }
+
+  // Previews of all other images are not needed anymore
+  QList<int> visible_image_indices;
+  for (int row = first_row; row <= last_row; row++)
+  {
+    visible_image_indices.push_back(image_sort_filter_proxy_model_->mapRowToSource(row));
+  }
+
+  image_list_model_->cancelPreviewImagesExcept(visible_image_indices);
+}
+
 ImageListModel::Mode MainWindow::selectedFolderMode() const
 {
   if (ui->annotation_mode_button->isChecked())
@@ -220,6 +346,11 @@ void MainWindow::onFolderModeChanged()
 
 void MainWindow::onLoadImage(int image_id)
 {
+  if (!image_load_timer_.isValid())
+  {
+    image_load_timer_.start();
+  }
+
   annotation_manager_->save();
 
   loadImage(image_id - 1);
@@ -227,8 +358,13 @@ void MainWindow::onLoadImage(int image_id)
 
 void MainWindow::onUpdateFiltering()
 {
-  // Filter by filename
-  image_sort_filter_proxy_model_->setFilterByFilename(ui->filter_by_filename_edit->text(), ui->filter_by_filename->isChecked());
+  // Filter by filename (a regular expression with syntax errors matches nothing)
+  const FilenamePattern filename_pattern(ui->filter_by_filename_edit->text(),
+                                         FilenamePattern::Syntax(ui->filter_by_filename_syntax->currentIndex()));
+
+  setFilterInputError(ui->filter_by_filename_edit,
+                      filename_pattern.isValid() ? QString() : filename_pattern.regular_expression.errorString());
+  image_sort_filter_proxy_model_->setFilterByFilename(filename_pattern, ui->filter_by_filename->isChecked());
 
   // Rel. object size
   image_sort_filter_proxy_model_->setFilterRelObjectSize(
@@ -238,9 +374,24 @@ void MainWindow::onUpdateFiltering()
   image_sort_filter_proxy_model_->setFilterByNumObjects(
       ui->min_num_objects->value(), ui->max_num_objects->value(), ui->filter_by_num_objects->isChecked());
 
-  // Filter by label id
-  image_sort_filter_proxy_model_->setFilterByLabelId(ui->filter_by_label_combobox->currentIndex(),
-                                                     ui->filter_by_label->isChecked());
+  // Filter by labels: the query if one is entered, otherwise the label of the combo box
+  QString label_query_error;
+  std::optional<LabelQuery> label_query;
+
+  if (ui->filter_by_label_query->text().trimmed().isEmpty())
+  {
+    label_query = LabelQuery();
+    label_query->all_of.insert(ui->filter_by_label_combobox->currentIndex());
+  }
+  else
+  {
+    label_query = LabelQuery::fromString(ui->filter_by_label_query->text(), label_names_, &label_query_error);
+  }
+
+  // An invalid query filters nothing until it is fixed
+  setFilterInputError(ui->filter_by_label_query, label_query_error);
+  image_sort_filter_proxy_model_->setFilterByLabels(label_query.value_or(LabelQuery()),
+                                                    ui->filter_by_label->isChecked() && label_query.has_value());
 }
 
 void MainWindow::onSelectFolder(const QItemSelection& selected, const QItemSelection& deselected)
@@ -254,14 +405,31 @@ void MainWindow::onSelectFolder(const QItemSelection& selected, const QItemSelec
 
 void MainWindow::onPrevImage()
 {
+  if (ui->image_slider->value() > ui->image_slider->minimum())
+  {
+    image_load_timer_.start();
+  }
   ui->image_slider->setValue(ui->image_slider->value() - 1);
 }
 
 void MainWindow::onNextImage()
 {
+  if (ui->image_slider->value() < ui->image_slider->maximum())
+  {
+    image_load_timer_.start();
+  }
   ui->image_slider->setValue(ui->image_slider->value() + 1);
 }
 
+void MainWindow::onImagePainted()
+{
+  if (image_load_timer_.isValid())
+  {
+    image_load_time_label_->setText(QString("Image shown after %1 ms").arg(image_load_timer_.elapsed()));
+    image_load_timer_.invalidate();
+  }
+}
+
 void MainWindow::onEditImage()
 {
   QProcess* image_editor_process = new QProcess(this);
@@ -452,22 +620,48 @@ void MainWindow::onStartPrediction(bool checked)
 
 void MainWindow::loadImage(const int image_idx)
 {
-  const QImage image = image_list_model_->getFullResImage(image_sort_filter_proxy_model_->mapRowToSource(image_idx));
-  const QString input_label_filename =
-      image_list_model_->getAnnotationInputFilename(image_sort_filter_proxy_model_->mapRowToSource(image_idx));
-  const QString output_label_filename =
-      image_list_model_->getAnnotationOutputFilename(image_sort_filter_proxy_model_->mapRowToSource(image_idx));
+  // Scaling to the CNN resolution is done while decoding, in the background
+  const QSize max_image_size = ui->scale_to_cnn_resolution->isChecked()
+                                   ? QSize(ui->cnn_image_size->currentText().toInt(), ui->cnn_image_size->currentText().toInt())
+                                   : QSize();
+
+  requested_image_key_ =
+      image_list_model_->getFullResImageKey(image_sort_filter_proxy_model_->mapRowToSource(image_idx), max_image_size);
 
-  if (ui->scale_to_cnn_resolution->isChecked())
+  if (const std::optional<QImage> image =
+          image_list_model_->requestFullResImage(image_sort_filter_proxy_model_->mapRowToSource(image_idx), max_image_size))
   {
-    const int cnn_image_size = QString(ui->cnn_image_size->currentText()).toInt();
-    ui->image_view->setImage(image.scaled(cnn_image_size, cnn_image_size, Qt::KeepAspectRatio), ui->fit_view_button->isChecked());
+    showImage(image_idx, *image);
   }
-  else
+
+  prefetchImages(image_idx, max_image_size);
+}
+
+void MainWindow::onFullResImageReady(const QString& key, const QImage& image)
+{
+  if (key != requested_image_key_)
   {
-    ui->image_view->setImage(image, ui->fit_view_button->isChecked());
+    return;
   }
 
+  // The slider stays at the requested image when rows are inserted or removed in the meantime
+  showImage(ui->image_slider->value() - 1, image);
+}
+
+void MainWindow::showImage(const int image_idx, const QImage& image)
+{
+  requested_image_key_.clear();
+
+  // The previous annotations could have been edited while the image was decoded
+  annotation_manager_->save();
+
+  const QString input_label_filename =
+      image_list_model_->getAnnotationInputFilename(image_sort_filter_proxy_model_->mapRowToSource(image_idx));
+  const QString output_label_filename =
+      image_list_model_->getAnnotationOutputFilename(image_sort_filter_proxy_model_->mapRowToSource(image_idx));
+
+  ui->image_view->setImage(image, ui->fit_view_button->isChecked());
+
   const QString image_filename = image_list_model_->getImageFilename(image_sort_filter_proxy_model_->mapRowToSource(image_idx));
 
   ui->image_index_label->setText(QString("Image %1 / %2: %3 (%4 x %5 px)")
@@ -497,6 +691,28 @@ void MainWindow::loadImage(const int image_idx)
   }
 }
 
+void MainWindow::prefetchImages(const int image_idx, const QSize& max_image_size)
+{
+  const int num_next_images = settings_.value("cache/prefetch_next_images", 4).toInt();
+  const int num_previous_images = settings_.value("cache/prefetch_previous_images", 2).toInt();
+
+  // The closest images first, the next ones before the previous ones
+  QList<int> image_indices;
+  for (int distance = 1; distance <= std::max(num_next_images, num_previous_images); distance++)
+  {
+    if (distance <= num_next_images && image_idx + distance < image_sort_filter_proxy_model_->rowCount())
+    {
+      image_indices.push_back(image_sort_filter_proxy_model_->mapRowToSource(image_idx + distance));
+    }
+    if (distance <= num_previous_images && image_idx - distance >= 0)
+    {
+      image_indices.push_back(image_sort_filter_proxy_model_->mapRowToSource(image_idx - distance));
+    }
+  }
+
+  image_list_model_->prefetchFullResImages(image_indices, max_image_size);
+}
+
 void MainWindow::closeEvent(QCloseEvent* event)
 {
   settings_.setValue("window/geometry", saveGeometry());
@@ -2,7 +2,9 @@
 
 #include <QFileSystemModel>
 #include <QGraphicsScene>
+#include <QElapsedTimer>
 #include <QItemSelection>
+#include <QLabel>
 #include <QMainWindow>
 #include <QProcess>
 #include <QScopedPointer>
@@ -23,7 +25,10 @@ class MainWindow : public QMainWindow
   Q_OBJECT
 
 public:
-  MainWindow(const QString& root_path, const QStringList& label_names, QWidget* parent = 0);
+  MainWindow(const QString& root_path,
+             const QStringList& label_names,
+             const PreviewCacheBackend preview_cache_backend = PreviewCacheBackend::SQLITE,
+             QWidget* parent = 0);
   virtual ~MainWindow();
 
 private:
@@ -56,9 +61,21 @@ private:
 
   QProcess predict_process_{this};
 
+  // Time from the key press (or slider move) until the new image is painted
+  QElapsedTimer image_load_timer_;
+  QLabel* image_load_time_label_{new QLabel(this)};
+
+  // The image that is shown next, results of images that were requested before are dropped
+  QString requested_image_key_;
+
   ImageListModel::Mode selectedFolderMode() const;
 
+  // Shows the image once it is decoded, the previous image stays visible until then
   void loadImage(const int image_idx);
+  void showImage(const int image_idx, const QImage& image);
+
+  // Decodes the images around image_idx (in the current sort and filter order) in the background
+  void prefetchImages(const int image_idx, const QSize& max_image_size);
 
   void closeEvent(QCloseEvent* event) override;
 
@@ -66,6 +83,13 @@ private:
 
 private slots:
   void onImageListModelReset();
+  void onImageListRowsInserted(const QModelIndex& parent, int first, int last);
+  void onImageListRowsRemoved(const QModelIndex& parent, int first, int last);
+
+  void onImageGridScrolled();
+
+  void onImagePainted();
+  void onFullResImageReady(const QString& key, const QImage& image);
 
   void onLoadImage(int idx);
   void onPrevImage();
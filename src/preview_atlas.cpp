@@ -0,0 +1,162 @@
+#include <QByteArray>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cstring>
+
+#include "preview_atlas.h"
+
+PreviewAtlas::PreviewAtlas(const QDir& root_path)
+    : atlas_path_(root_path.absoluteFilePath("preview_atlas"))
+{
+  QDir().mkpath(atlas_path_.absolutePath());
+
+  index_file_.setFileName(atlas_path_.absoluteFilePath("index"));
+  if (!index_file_.open(QIODevice::ReadWrite))
+  {
+    qDebug() << "Could not open " << index_file_.fileName();
+    return;
+  }
+
+  loadIndex();
+}
+
+void PreviewAtlas::loadIndex()
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  // Only slots whose pack file exists completely are valid
+  qint32 num_available_slots = 0;
+  while (QFileInfo(packFilename(num_available_slots / slots_per_pack_)).size() == pack_size_)
+  {
+    num_available_slots += slots_per_pack_;
+  }
+
+  const QByteArray index_data = index_file_.readAll();
+  const qsizetype num_records = index_data.size() / qsizetype(sizeof(IndexRecord));
+
+  for (qsizetype i = 0; i < num_records; i++)
+  {
+    IndexRecord record;
+    std::memcpy(&record, index_data.constData() + i * sizeof(IndexRecord), sizeof(IndexRecord));
+
+    if (record.slot.index < 0 || record.slot.index >= num_available_slots || record.slot.width <= 0 ||
+        record.slot.width > max_preview_size || record.slot.height <= 0 || record.slot.height > max_preview_size)
+    {
+      continue;
+    }
+
+    // Later records replace earlier ones
+    slots_.insert(key(QByteArray(record.md5_hash, sizeof(record.md5_hash)).toHex(), record.filesize), record.slot);
+    num_slots_ = std::max(num_slots_, record.slot.index + 1);
+  }
+
+  // Drop an incomplete record (e.g. after a crash), so that new records are aligned again
+  index_file_.resize(num_records * sizeof(IndexRecord));
+  index_file_.seek(index_file_.size());
+
+  qDebug() << "Loading the preview atlas index (" << slots_.size() << " previews) took " << timer.elapsed() << "ms";
+}
+
+void PreviewAtlas::store(const QString& md5_hash, const int filesize, const QImage& image)
+{
+  const QImage rgb_image = image.convertToFormat(QImage::Format_RGB888);
+
+  if (rgb_image.isNull() || rgb_image.width() > max_preview_size || rgb_image.height() > max_preview_size ||
+      !index_file_.isOpen())
+  {
+    return;
+  }
+
+  QMutexLocker locker(&mutex_);
+
+  // Append only, a replaced preview keeps its old slot
+  const Slot slot{num_slots_, rgb_image.width(), rgb_image.height()};
+
+  uchar* slot_data = slotData(slot.index);
+  if (slot_data == nullptr)
+  {
+    return;
+  }
+
+  for (int y = 0; y < rgb_image.height(); y++)
+  {
+    std::memcpy(slot_data + y * bytes_per_line_, rgb_image.constScanLine(y), rgb_image.width() * 3);
+  }
+
+  IndexRecord record;
+  const QByteArray raw_md5_hash = QByteArray::fromHex(md5_hash.toLatin1());
+  std::memset(record.md5_hash, 0, sizeof(record.md5_hash));
+  std::memcpy(record.md5_hash, raw_md5_hash.constData(), std::min<qsizetype>(raw_md5_hash.size(), sizeof(record.md5_hash)));
+  record.filesize = filesize;
+  record.slot = slot;
+
+  index_file_.write((const char*)&record, sizeof(IndexRecord));
+  index_file_.flush();
+
+  slots_.insert(key(md5_hash, filesize), slot);
+  num_slots_++;
+}
+
+std::optional<QImage> PreviewAtlas::get(const QString& md5_hash, const int filesize)
+{
+  QMutexLocker locker(&mutex_);
+
+  const auto slot = slots_.constFind(key(md5_hash, filesize));
+
+  if (slot == slots_.constEnd())
+  {
+    return {};
+  }
+
+  const uchar* slot_data = slotData(slot->index);
+  if (slot_data == nullptr)
+  {
+    return {};
+  }
+
+  // No copy, painting on the image detaches it
+  return QImage(slot_data, slot->width, slot->height, bytes_per_line_, QImage::Format_RGB888);
+}
+
+QString PreviewAtlas::key(const QString& md5_hash, const int filesize)
+{
+  return md5_hash + ":" + QString::number(filesize);
+}
+
+QString PreviewAtlas::packFilename(const qsizetype pack_index) const
+{
+  return atlas_path_.absoluteFilePath(QString("%1.pack").arg(pack_index, 5, 10, QChar('0')));
+}
+
+uchar* PreviewAtlas::slotData(const qint32 slot_index)
+{
+  const qsizetype pack_index = slot_index / slots_per_pack_;
+
+  while (qsizetype(mapped_packs_.size()) <= pack_index)
+  {
+    auto pack_file = std::make_unique<QFile>(packFilename(mapped_packs_.size()));
+
+    if (!pack_file->open(QIODevice::ReadWrite) || (pack_file->size() != pack_size_ && !pack_file->resize(pack_size_)))
+    {
+      qDebug() << "Could not open " << pack_file->fileName();
+      return nullptr;
+    }
+
+    uchar* mapped_pack = pack_file->map(0, pack_size_);
+    if (mapped_pack == nullptr)
+    {
+      qDebug() << "Could not map " << pack_file->fileName();
+      return nullptr;
+    }
+
+    pack_files_.push_back(std::move(pack_file));
+    mapped_packs_.push_back(mapped_pack);
+  }
+
+  return mapped_packs_[pack_index] + (slot_index % slots_per_pack_) * slot_size_;
+}
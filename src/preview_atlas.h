@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Append-only cache of preview images, as an alternative to the preview_images table of the cache database.
+// All previews are stored as RGB888 in slots of a fixed size, which are memory mapped. An index file maps
+// (md5_hash, filesize) to the slot of a preview.
+// Previews can be stored from one thread while they are looked up from another one.
+class PreviewAtlas
+{
+public:
+  explicit PreviewAtlas(const QDir& root_path);
+
+  // The image must not be larger than max_preview_size x max_preview_size
+  void store(const QString& md5_hash, const int filesize, const QImage& image);
+
+  // The returned image directly uses the mapped memory, so it is only valid as long as the atlas exists
+  std::optional<QImage> get(const QString& md5_hash, const int filesize);
+
+  static constexpr int max_preview_size = 128;
+
+private:
+  static constexpr qsizetype bytes_per_line_ = max_preview_size * 3;
+  static constexpr qsizetype slot_size_ = bytes_per_line_ * max_preview_size;
+
+  // The slots are split into pack files of a fixed size, so a file never has to be resized while it is mapped
+  static constexpr qsizetype slots_per_pack_ = 256;
+  static constexpr qsizetype pack_size_ = slot_size_ * slots_per_pack_;
+
+  struct Slot
+  {
+    qint32 index;
+    qint32 width;
+    qint32 height;
+  };
+
+  // Format of the records in the index file
+  struct IndexRecord
+  {
+    char md5_hash[16];
+    qint32 filesize;
+    Slot slot;
+  };
+
+  static QString key(const QString& md5_hash, const int filesize);
+
+  QString packFilename(const qsizetype pack_index) const;
+
+  void loadIndex();
+
+  // Opens and maps the pack file of the slot if needed. Needs a locked mutex_.
+  uchar* slotData(const qint32 slot_index);
+
+  const QDir atlas_path_;
+  QFile index_file_;
+
+  QMutex mutex_;
+  QHash<QString, Slot> slots_;
+  qint32 num_slots_{0};
+
+  // The pack files stay mapped until the atlas is destroyed, so the handed out images do not need to be copied
+  std::vector<std::unique_ptr<QFile>> pack_files_;
+  std::vector<uchar*> mapped_packs_;
+};
@@ -0,0 +1,360 @@
+#include <QBuffer>
+#include <QByteArray>
+#include <QDebug>
+
+#include <array>
+#include <cstring>
+
+#include "preview_image_codec.h"
+
+namespace
+{
+const int jpeg_quality = 90;
+const int webp_quality = 90;
+
+// See https://qoiformat.org/qoi-specification.pdf
+const unsigned char qoi_op_index = 0x00;
+const unsigned char qoi_op_diff = 0x40;
+const unsigned char qoi_op_luma = 0x80;
+const unsigned char qoi_op_run = 0xc0;
+const unsigned char qoi_op_rgb = 0xfe;
+const unsigned char qoi_op_rgba = 0xff;
+const unsigned char qoi_mask = 0xc0;
+
+const int qoi_header_size = 14;
+const std::array<unsigned char, 8> qoi_end_marker = {0, 0, 0, 0, 0, 0, 0, 1};
+
+struct QOIPixel
+{
+  unsigned char r{0};
+  unsigned char g{0};
+  unsigned char b{0};
+  unsigned char a{0};
+
+  bool operator==(const QOIPixel& other) const
+  {
+    return r == other.r && g == other.g && b == other.b && a == other.a;
+  }
+
+  int hash() const
+  {
+    return (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+  }
+};
+
+void appendUInt32(std::vector<char>& data, const quint32 value)
+{
+  data.push_back(char(value >> 24));
+  data.push_back(char(value >> 16));
+  data.push_back(char(value >> 8));
+  data.push_back(char(value));
+}
+
+std::vector<char> encodeWithImageWriter(const QImage& image, const char* format, const int quality)
+{
+  QByteArray encoded_data;
+  QBuffer buffer(&encoded_data);
+  buffer.open(QIODevice::WriteOnly);
+
+  if (!image.save(&buffer, format, quality))
+  {
+    return {};
+  }
+
+  return std::vector<char>(encoded_data.begin(), encoded_data.end());
+}
+} // namespace
+
+PreviewCodec PreviewImageCodec::codecFromName(const QString& name)
+{
+  const QString lower_name = name.toLower();
+
+  if (lower_name == "raw")
+  {
+    return PreviewCodec::RAW_RGB888;
+  }
+  if (lower_name == "jpeg" || lower_name == "jpg")
+  {
+    return PreviewCodec::JPEG;
+  }
+  if (lower_name == "webp")
+  {
+    return PreviewCodec::WEBP;
+  }
+  if (lower_name != "qoi")
+  {
+    qDebug() << "Unknown preview codec " << name << ", using qoi";
+  }
+
+  return PreviewCodec::QOI;
+}
+
+EncodedPreviewImage PreviewImageCodec::encode(const QImage& image, const PreviewCodec codec)
+{
+  const QImage rgb_image = image.convertToFormat(QImage::Format_RGB888);
+
+  EncodedPreviewImage encoded_image;
+  encoded_image.codec = codec;
+  encoded_image.width = rgb_image.width();
+  encoded_image.height = rgb_image.height();
+
+  switch (codec)
+  {
+  case PreviewCodec::JPEG:
+    encoded_image.data = encodeWithImageWriter(rgb_image, "JPG", jpeg_quality);
+    break;
+
+  case PreviewCodec::WEBP:
+    encoded_image.data = encodeWithImageWriter(rgb_image, "WEBP", webp_quality);
+    break;
+
+  case PreviewCodec::QOI:
+    encoded_image.data = encodeQOI(rgb_image);
+    break;
+
+  case PreviewCodec::RAW_RGB888:
+    break;
+  }
+
+  if (encoded_image.data.empty())
+  {
+    encoded_image.codec = PreviewCodec::RAW_RGB888;
+    encoded_image.data.resize(rgb_image.sizeInBytes());
+    std::memcpy(encoded_image.data.data(), rgb_image.constBits(), rgb_image.sizeInBytes());
+  }
+
+  return encoded_image;
+}
+
+QImage PreviewImageCodec::decode(const EncodedPreviewImage& encoded_image)
+{
+  QImage image;
+
+  switch (encoded_image.codec)
+  {
+  case PreviewCodec::RAW_RGB888:
+  {
+    image = QImage(encoded_image.width, encoded_image.height, QImage::Format_RGB888);
+    if (image.isNull() || qsizetype(encoded_image.data.size()) != image.sizeInBytes())
+    {
+      return QImage();
+    }
+    std::memcpy(image.bits(), encoded_image.data.data(), image.sizeInBytes());
+    return image;
+  }
+
+  case PreviewCodec::JPEG:
+    image = QImage::fromData((const uchar*)encoded_image.data.data(), int(encoded_image.data.size()), "JPG");
+    break;
+
+  case PreviewCodec::WEBP:
+    image = QImage::fromData((const uchar*)encoded_image.data.data(), int(encoded_image.data.size()), "WEBP");
+    break;
+
+  case PreviewCodec::QOI:
+    image = decodeQOI(encoded_image.data, encoded_image.width, encoded_image.height);
+    break;
+  }
+
+  if (image.isNull())
+  {
+    return QImage();
+  }
+
+  return image.convertToFormat(QImage::Format_RGB888);
+}
+
+std::vector<char> PreviewImageCodec::encodeQOI(const QImage& image)
+{
+  std::vector<char> data;
+  data.reserve(qoi_header_size + image.width() * image.height() * 4 + qoi_end_marker.size());
+
+  data.insert(data.end(), {'q', 'o', 'i', 'f'});
+  appendUInt32(data, image.width());
+  appendUInt32(data, image.height());
+  data.push_back(3); // RGB
+  data.push_back(0); // sRGB with linear alpha
+
+  std::array<QOIPixel, 64> index{};
+  QOIPixel previous_pixel{0, 0, 0, 255};
+  int run = 0;
+
+  for (int y = 0; y < image.height(); y++)
+  {
+    const uchar* line = image.constScanLine(y);
+
+    for (int x = 0; x < image.width(); x++)
+    {
+      const QOIPixel pixel{line[3 * x], line[3 * x + 1], line[3 * x + 2], 255};
+
+      if (pixel == previous_pixel)
+      {
+        run++;
+        if (run == 62)
+        {
+          data.push_back(char(qoi_op_run | (run - 1)));
+          run = 0;
+        }
+        continue;
+      }
+
+      if (run > 0)
+      {
+        data.push_back(char(qoi_op_run | (run - 1)));
+        run = 0;
+      }
+
+      const int index_pos = pixel.hash();
+
+      if (index[index_pos] == pixel)
+      {
+        data.push_back(char(qoi_op_index | index_pos));
+      }
+      else
+      {
+        index[index_pos] = pixel;
+
+        const signed char vr = pixel.r - previous_pixel.r;
+        const signed char vg = pixel.g - previous_pixel.g;
+        const signed char vb = pixel.b - previous_pixel.b;
+
+        const signed char vg_r = vr - vg;
+        const signed char vg_b = vb - vg;
+
+        if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+        {
+          data.push_back(char(qoi_op_diff | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+        }
+        else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8)
+        {
+          data.push_back(char(qoi_op_luma | (vg + 32)));
+          data.push_back(char((vg_r + 8) << 4 | (vg_b + 8)));
+        }
+        else
+        {
+          data.push_back(char(qoi_op_rgb));
+          data.push_back(char(pixel.r));
+          data.push_back(char(pixel.g));
+          data.push_back(char(pixel.b));
+        }
+      }
+
+      previous_pixel = pixel;
+    }
+  }
+
+  if (run > 0)
+  {
+    data.push_back(char(qoi_op_run | (run - 1)));
+  }
+
+  data.insert(data.end(), qoi_end_marker.begin(), qoi_end_marker.end());
+
+  return data;
+}
+
+QImage PreviewImageCodec::decodeQOI(const std::vector<char>& data, const int width, const int height)
+{
+  const unsigned char* bytes = (const unsigned char*)data.data();
+  const size_t size = data.size();
+
+  if (size < qoi_header_size + qoi_end_marker.size() || std::memcmp(bytes, "qoif", 4) != 0)
+  {
+    return QImage();
+  }
+
+  const auto readUInt32 = [bytes](const size_t pos)
+  { return quint32(bytes[pos]) << 24 | quint32(bytes[pos + 1]) << 16 | quint32(bytes[pos + 2]) << 8 | quint32(bytes[pos + 3]); };
+
+  if (readUInt32(4) != quint32(width) || readUInt32(8) != quint32(height))
+  {
+    return QImage();
+  }
+
+  QImage image(width, height, QImage::Format_RGB888);
+  if (image.isNull())
+  {
+    return QImage();
+  }
+
+  std::array<QOIPixel, 64> index{};
+  QOIPixel pixel{0, 0, 0, 255};
+  int run = 0;
+
+  size_t pos = qoi_header_size;
+  const size_t chunks_end = size - qoi_end_marker.size();
+
+  for (int y = 0; y < height; y++)
+  {
+    uchar* line = image.scanLine(y);
+
+    for (int x = 0; x < width; x++)
+    {
+      if (run > 0)
+      {
+        run--;
+      }
+      else
+      {
+        if (pos >= chunks_end)
+        {
+          return QImage();
+        }
+
+        const unsigned char b1 = bytes[pos++];
+
+        if (b1 == qoi_op_rgb || b1 == qoi_op_rgba)
+        {
+          const size_t num_channels = b1 == qoi_op_rgb ? 3 : 4;
+          if (pos + num_channels > chunks_end)
+          {
+            return QImage();
+          }
+
+          pixel.r = bytes[pos++];
+          pixel.g = bytes[pos++];
+          pixel.b = bytes[pos++];
+          if (num_channels == 4)
+          {
+            pixel.a = bytes[pos++];
+          }
+        }
+        else if ((b1 & qoi_mask) == qoi_op_index)
+        {
+          pixel = index[b1];
+        }
+        else if ((b1 & qoi_mask) == qoi_op_diff)
+        {
+          pixel.r += ((b1 >> 4) & 0x03) - 2;
+          pixel.g += ((b1 >> 2) & 0x03) - 2;
+          pixel.b += (b1 & 0x03) - 2;
+        }
+        else if ((b1 & qoi_mask) == qoi_op_luma)
+        {
+          if (pos >= chunks_end)
+          {
+            return QImage();
+          }
+
+          const unsigned char b2 = bytes[pos++];
+          const int vg = (b1 & 0x3f) - 32;
+          pixel.r += vg - 8 + ((b2 >> 4) & 0x0f);
+          pixel.g += vg;
+          pixel.b += vg - 8 + (b2 & 0x0f);
+        }
+        else
+        {
+          run = b1 & 0x3f;
+        }
+
+        index[pixel.hash()] = pixel;
+      }
+
+      line[3 * x] = pixel.r;
+      line[3 * x + 1] = pixel.g;
+      line[3 * x + 2] = pixel.b;
+    }
+  }
+
+  return image;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QImage>
+#include <QString>
+
+#include <vector>
+
+// How a preview image is stored in the preview_image column of the cache database.
+// The values are stored per row, so they must not change.
+enum class PreviewCodec : int
+{
+  RAW_RGB888 = 0,
+  JPEG = 1,
+  WEBP = 2,
+  QOI = 3, // Lossless, but much faster to encode and decode than PNG
+};
+
+struct EncodedPreviewImage
+{
+  PreviewCodec codec{PreviewCodec::RAW_RGB888};
+  int width{0};
+  int height{0};
+  std::vector<char> data;
+};
+
+struct PreviewImageCodec
+{
+  // "raw", "jpeg", "webp" or "qoi" (e.g. from the settings), QOI for unknown names
+  static PreviewCodec codecFromName(const QString& name);
+
+  // Falls back to RAW_RGB888 if the codec is not available (e.g. no WebP image plugin)
+  static EncodedPreviewImage encode(const QImage& image, const PreviewCodec codec);
+
+  // Returns an RGB888 image, or a null image if the data is corrupt
+  static QImage decode(const EncodedPreviewImage& encoded_image);
+
+private:
+  static std::vector<char> encodeQOI(const QImage& image);
+  static QImage decodeQOI(const std::vector<char>& data, const int width, const int height);
+};
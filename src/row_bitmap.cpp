@@ -0,0 +1,429 @@
+#include <algorithm>
+
+#include <QtAlgorithms>
+
+#include "row_bitmap.h"
+
+bool RowBitmap::Container::isDense() const
+{
+  return !words.empty();
+}
+
+RowBitmap RowBitmap::range(const int first, const int last)
+{
+  RowBitmap bitmap;
+
+  for (int key = first >> 16; first <= last && key <= (last >> 16); key++)
+  {
+    const int low_first = std::max(first, key << 16) & 0xFFFF;
+    const int low_last = std::min(last, (key << 16) | 0xFFFF) & 0xFFFF;
+
+    Container container;
+    container.key = quint16(key);
+    container.cardinality = low_last - low_first + 1;
+    container.words.assign(num_words, 0);
+
+    for (int low = low_first; low <= low_last; low++)
+    {
+      container.words[low >> 6] |= quint64(1) << (low & 63);
+    }
+
+    normalize(container);
+    bitmap.containers_.push_back(std::move(container));
+  }
+
+  return bitmap;
+}
+
+bool RowBitmap::isEmpty() const
+{
+  return containers_.empty();
+}
+
+int RowBitmap::cardinality() const
+{
+  int cardinality = 0;
+
+  for (const Container& container : containers_)
+  {
+    cardinality += container.cardinality;
+  }
+
+  return cardinality;
+}
+
+void RowBitmap::add(const int row)
+{
+  const quint16 key = quint16(row >> 16);
+  const quint16 low = quint16(row & 0xFFFF);
+
+  auto container = findContainer(key);
+
+  if (container == containers_.end())
+  {
+    Container new_container;
+    new_container.key = key;
+
+    container = containers_.insert(
+        std::lower_bound(containers_.begin(),
+                         containers_.end(),
+                         key,
+                         [](const Container& container, const quint16 key) { return container.key < key; }),
+        std::move(new_container));
+  }
+
+  if (container->isDense())
+  {
+    quint64& word = container->words[low >> 6];
+    const quint64 bit = quint64(1) << (low & 63);
+
+    if (!(word & bit))
+    {
+      word |= bit;
+      container->cardinality++;
+    }
+  }
+  else
+  {
+    const auto value = std::lower_bound(container->values.begin(), container->values.end(), low);
+
+    if (value == container->values.end() || *value != low)
+    {
+      container->values.insert(value, low);
+      container->cardinality++;
+
+      normalize(*container);
+    }
+  }
+}
+
+void RowBitmap::remove(const int row)
+{
+  const auto container = findContainer(quint16(row >> 16));
+
+  if (container == containers_.end())
+  {
+    return;
+  }
+
+  const quint16 low = quint16(row & 0xFFFF);
+
+  if (container->isDense())
+  {
+    quint64& word = container->words[low >> 6];
+    const quint64 bit = quint64(1) << (low & 63);
+
+    if (word & bit)
+    {
+      word &= ~bit;
+      container->cardinality--;
+    }
+  }
+  else
+  {
+    const auto value = std::lower_bound(container->values.begin(), container->values.end(), low);
+
+    if (value != container->values.end() && *value == low)
+    {
+      container->values.erase(value);
+      container->cardinality--;
+    }
+  }
+
+  if (container->cardinality == 0)
+  {
+    containers_.erase(container);
+  }
+  else
+  {
+    normalize(*container);
+  }
+}
+
+RowBitmap& RowBitmap::operator&=(const RowBitmap& other)
+{
+  std::vector<Container> containers;
+
+  auto container1 = containers_.cbegin();
+  auto container2 = other.containers_.cbegin();
+
+  while (container1 != containers_.cend() && container2 != other.containers_.cend())
+  {
+    if (container1->key < container2->key)
+    {
+      container1++;
+    }
+    else if (container2->key < container1->key)
+    {
+      container2++;
+    }
+    else
+    {
+      Container container = combine(*container1, *container2, Operation::And);
+      if (container.cardinality > 0)
+      {
+        containers.push_back(std::move(container));
+      }
+
+      container1++;
+      container2++;
+    }
+  }
+
+  containers_ = std::move(containers);
+
+  return *this;
+}
+
+RowBitmap& RowBitmap::operator|=(const RowBitmap& other)
+{
+  std::vector<Container> containers;
+  containers.reserve(containers_.size() + other.containers_.size());
+
+  auto container1 = containers_.cbegin();
+  auto container2 = other.containers_.cbegin();
+
+  while (container1 != containers_.cend() || container2 != other.containers_.cend())
+  {
+    if (container2 == other.containers_.cend() || (container1 != containers_.cend() && container1->key < container2->key))
+    {
+      containers.push_back(*container1++);
+    }
+    else if (container1 == containers_.cend() || container2->key < container1->key)
+    {
+      containers.push_back(*container2++);
+    }
+    else
+    {
+      containers.push_back(combine(*container1++, *container2++, Operation::Or));
+    }
+  }
+
+  containers_ = std::move(containers);
+
+  return *this;
+}
+
+RowBitmap& RowBitmap::operator-=(const RowBitmap& other)
+{
+  std::vector<Container> containers;
+  containers.reserve(containers_.size());
+
+  auto container2 = other.containers_.cbegin();
+
+  for (auto container1 = containers_.cbegin(); container1 != containers_.cend(); container1++)
+  {
+    while (container2 != other.containers_.cend() && container2->key < container1->key)
+    {
+      container2++;
+    }
+
+    if (container2 == other.containers_.cend() || container2->key != container1->key)
+    {
+      containers.push_back(*container1);
+      continue;
+    }
+
+    Container container = combine(*container1, *container2, Operation::AndNot);
+    if (container.cardinality > 0)
+    {
+      containers.push_back(std::move(container));
+    }
+  }
+
+  containers_ = std::move(containers);
+
+  return *this;
+}
+
+void RowBitmap::toMask(const int first, const int last, char* mask) const
+{
+  if (first > last)
+  {
+    return;
+  }
+
+  std::fill(mask, mask + last - first + 1, 0);
+
+  for (const Container& container : containers_)
+  {
+    const int container_first = int(container.key) << 16;
+
+    if (container_first > last || container_first + 0xFFFF < first)
+    {
+      continue;
+    }
+
+    const int low_first = std::max(first - container_first, 0);
+    const int low_last = std::min(last - container_first, 0xFFFF);
+
+    if (container.isDense())
+    {
+      for (int word_index = low_first >> 6; word_index <= (low_last >> 6); word_index++)
+      {
+        quint64 word = container.words[word_index];
+
+        while (word)
+        {
+          const int low = (word_index << 6) + qCountTrailingZeroBits(word);
+          word &= word - 1;
+
+          if (low >= low_first && low <= low_last)
+          {
+            mask[container_first + low - first] = 1;
+          }
+        }
+      }
+    }
+    else
+    {
+      for (auto value = std::lower_bound(container.values.begin(), container.values.end(), quint16(low_first));
+           value != container.values.end() && *value <= low_last;
+           value++)
+      {
+        mask[container_first + *value - first] = 1;
+      }
+    }
+  }
+}
+
+std::vector<RowBitmap::Container>::iterator RowBitmap::findContainer(const quint16 key)
+{
+  const auto container = std::lower_bound(
+      containers_.begin(), containers_.end(), key, [](const Container& container, const quint16 key) { return container.key < key; });
+
+  return container != containers_.end() && container->key == key ? container : containers_.end();
+}
+
+void RowBitmap::makeDense(Container& container)
+{
+  container.words.assign(num_words, 0);
+
+  for (const quint16 value : container.values)
+  {
+    container.words[value >> 6] |= quint64(1) << (value & 63);
+  }
+
+  container.values = {};
+}
+
+void RowBitmap::makeSparse(Container& container)
+{
+  std::vector<quint16> values;
+  values.reserve(container.cardinality);
+
+  for (int word_index = 0; word_index < num_words; word_index++)
+  {
+    quint64 word = container.words[word_index];
+
+    while (word)
+    {
+      values.push_back(quint16((word_index << 6) + qCountTrailingZeroBits(word)));
+      word &= word - 1;
+    }
+  }
+
+  container.values = std::move(values);
+  container.words = {};
+}
+
+void RowBitmap::normalize(Container& container)
+{
+  if (container.isDense() && container.cardinality <= max_sparse_cardinality)
+  {
+    makeSparse(container);
+  }
+  else if (!container.isDense() && container.cardinality > max_sparse_cardinality)
+  {
+    makeDense(container);
+  }
+}
+
+RowBitmap::Container RowBitmap::combine(const Container& container1, const Container& container2, const Operation operation)
+{
+  Container result;
+  result.key = container1.key;
+
+  // Two sparse containers => merge the sorted values
+  if (!container1.isDense() && !container2.isDense())
+  {
+    auto output = std::back_inserter(result.values);
+
+    switch (operation)
+    {
+      case Operation::And:
+        std::set_intersection(container1.values.begin(),
+                              container1.values.end(),
+                              container2.values.begin(),
+                              container2.values.end(),
+                              output);
+        break;
+
+      case Operation::Or:
+        std::set_union(container1.values.begin(),
+                       container1.values.end(),
+                       container2.values.begin(),
+                       container2.values.end(),
+                       output);
+        break;
+
+      case Operation::AndNot:
+        std::set_difference(container1.values.begin(),
+                            container1.values.end(),
+                            container2.values.begin(),
+                            container2.values.end(),
+                            output);
+        break;
+    }
+
+    result.cardinality = int(result.values.size());
+    normalize(result);
+
+    return result;
+  }
+
+  // Otherwise combine them word by word
+  Container sparse_as_dense;
+
+  const Container* dense1 = &container1;
+  const Container* dense2 = &container2;
+
+  if (!container1.isDense())
+  {
+    sparse_as_dense = container1;
+    makeDense(sparse_as_dense);
+    dense1 = &sparse_as_dense;
+  }
+  else if (!container2.isDense())
+  {
+    sparse_as_dense = container2;
+    makeDense(sparse_as_dense);
+    dense2 = &sparse_as_dense;
+  }
+
+  result.words.resize(num_words);
+
+  for (int word_index = 0; word_index < num_words; word_index++)
+  {
+    switch (operation)
+    {
+      case Operation::And:
+        result.words[word_index] = dense1->words[word_index] & dense2->words[word_index];
+        break;
+
+      case Operation::Or:
+        result.words[word_index] = dense1->words[word_index] | dense2->words[word_index];
+        break;
+
+      case Operation::AndNot:
+        result.words[word_index] = dense1->words[word_index] & ~dense2->words[word_index];
+        break;
+    }
+
+    result.cardinality += qPopulationCount(result.words[word_index]);
+  }
+
+  normalize(result);
+
+  return result;
+}
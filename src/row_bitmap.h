@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <vector>
+
+// Compressed set of (non-negative) row numbers, organized like a roaring bitmap:
+// The rows are grouped by their upper 16 bits, every group is stored either as a sorted array of
+// the lower 16 bits (sparse groups) or as a bitset of 65536 bits (dense groups).
+// The set operations work group by group and on 64 bit words within dense groups.
+class RowBitmap
+{
+public:
+  // The rows first..last
+  static RowBitmap range(const int first, const int last);
+
+  bool isEmpty() const;
+  int cardinality() const;
+
+  void add(const int row);
+  void remove(const int row);
+
+  RowBitmap& operator&=(const RowBitmap& other);
+  RowBitmap& operator|=(const RowBitmap& other);
+  // Removes the rows of other
+  RowBitmap& operator-=(const RowBitmap& other);
+
+  // Writes 1 (contained) or 0 for the rows first..last to mask[0..last - first]
+  void toMask(const int first, const int last, char* mask) const;
+
+private:
+  struct Container
+  {
+    quint16 key{0};
+    int cardinality{0};
+
+    // Sorted lower 16 bits of the rows, if the container is sparse
+    std::vector<quint16> values;
+    // 1024 words, if the container is dense
+    std::vector<quint64> words;
+
+    bool isDense() const;
+  };
+
+  enum class Operation
+  {
+    And,
+    Or,
+    AndNot
+  };
+
+  // Sparse containers with more values are converted into dense ones and vice versa
+  static constexpr int max_sparse_cardinality = 4096;
+  static constexpr int num_words = 1024;
+
+  // Sorted by key, none of them is empty
+  std::vector<Container> containers_;
+
+  std::vector<Container>::iterator findContainer(const quint16 key);
+
+  static void makeDense(Container& container);
+  static void makeSparse(Container& container);
+  static void normalize(Container& container);
+
+  static Container combine(const Container& container1, const Container& container2, const Operation operation);
+};
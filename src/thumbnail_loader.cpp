@@ -0,0 +1,138 @@
+#include <QImageReader>
+#include <QMutexLocker>
+
+#include "thumbnail_loader.h"
+
+ThumbnailLoader::ThumbnailLoader(QObject* parent)
+    : QObject(parent)
+{
+}
+
+ThumbnailLoader::~ThumbnailLoader()
+{
+  cancelAll();
+  thread_pool_.waitForDone();
+}
+
+void ThumbnailLoader::request(const QString& md5_hash,
+                              const int filesize,
+                              const QString& image_path,
+                              const std::optional<EncodedPreviewImage>& encoded_preview_image)
+{
+  const QString request_key = key(md5_hash, filesize);
+
+  if (requested_keys_.contains(request_key))
+  {
+    return;
+  }
+
+  requested_keys_.insert(request_key);
+
+  QMutexLocker locker(&mutex_);
+
+  queued_requests_.push_back(Request{md5_hash, filesize, image_path, encoded_preview_image});
+
+  if (num_active_workers_ < thread_pool_.maxThreadCount())
+  {
+    num_active_workers_++;
+    thread_pool_.start([this]() { processRequests(); });
+  }
+}
+
+void ThumbnailLoader::cancelAllExcept(const QSet<QString>& keys)
+{
+  QMutexLocker locker(&mutex_);
+
+  for (auto it = queued_requests_.begin(); it != queued_requests_.end();)
+  {
+    const QString request_key = key(it->md5_hash, it->filesize);
+
+    if (keys.contains(request_key))
+    {
+      it++;
+    }
+    else
+    {
+      requested_keys_.remove(request_key);
+      it = queued_requests_.erase(it);
+    }
+  }
+}
+
+void ThumbnailLoader::cancelAll()
+{
+  cancelAllExcept({});
+}
+
+QString ThumbnailLoader::key(const QString& md5_hash, const int filesize)
+{
+  return md5_hash + ":" + QString::number(filesize);
+}
+
+QImage ThumbnailLoader::createPreviewImage(const QString& image_path)
+{
+  const QSize preview_size(128, 128);
+
+  QImageReader image_reader(image_path);
+
+  // Let the decoder produce the preview resolution directly (e.g. JPEG scales in the DCT domain),
+  // instead of decoding the full image and throwing away most of it.
+  const QSize image_size = image_reader.size();
+  if (image_size.isValid())
+  {
+    image_reader.setScaledSize(image_size.scaled(preview_size, Qt::KeepAspectRatio));
+  }
+
+  QImage preview_image = image_reader.read();
+
+  // Fallback for formats that can not report their size upfront
+  if (preview_image.width() > preview_size.width() || preview_image.height() > preview_size.height())
+  {
+    preview_image = preview_image.scaled(preview_size, Qt::KeepAspectRatio, Qt::FastTransformation);
+  }
+
+  return preview_image.convertToFormat(QImage::Format_RGB888);
+}
+
+void ThumbnailLoader::processRequests()
+{
+  while (true)
+  {
+    Request request;
+
+    {
+      QMutexLocker locker(&mutex_);
+
+      if (queued_requests_.isEmpty())
+      {
+        num_active_workers_--;
+        return;
+      }
+
+      // The latest request first
+      request = queued_requests_.takeLast();
+    }
+
+    QImage preview_image;
+    if (request.encoded_preview_image)
+    {
+      preview_image = PreviewImageCodec::decode(*request.encoded_preview_image);
+    }
+
+    // Also recreates previews that could not be decoded
+    const bool created = preview_image.isNull();
+    if (created)
+    {
+      preview_image = createPreviewImage(request.image_path);
+    }
+
+    QMetaObject::invokeMethod(
+        this,
+        [this, md5_hash = request.md5_hash, filesize = request.filesize, preview_image, created]()
+        {
+          requested_keys_.remove(key(md5_hash, filesize));
+          emit previewImageReady(md5_hash, filesize, preview_image, created);
+        },
+        Qt::QueuedConnection);
+  }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+
+#include <optional>
+
+#include "preview_image_codec.h"
+
+// Creates (or decodes cached) preview images of the grid view on a pool of background threads.
+// The latest requests are served first, so the rows that are currently shown come in before older ones.
+class ThumbnailLoader : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit ThumbnailLoader(QObject* parent = nullptr);
+  ~ThumbnailLoader();
+
+  // Requests for a key that is already queued (or being created) are ignored.
+  // If encoded_preview_image is given, it is decoded instead of creating the preview from the image.
+  void request(const QString& md5_hash,
+               const int filesize,
+               const QString& image_path,
+               const std::optional<EncodedPreviewImage>& encoded_preview_image = std::nullopt);
+
+  // Drops all queued requests whose key is not in keys (e.g. rows that were scrolled out of view)
+  void cancelAllExcept(const QSet<QString>& keys);
+  void cancelAll();
+
+  static QString key(const QString& md5_hash, const int filesize);
+
+  static QImage createPreviewImage(const QString& image_path);
+
+signals:
+  // created is false if the preview was decoded from an EncodedPreviewImage
+  void previewImageReady(const QString& md5_hash, const int filesize, const QImage& preview_image, const bool created);
+
+private:
+  struct Request
+  {
+    QString md5_hash;
+    int filesize;
+    QString image_path;
+    std::optional<EncodedPreviewImage> encoded_preview_image;
+  };
+
+  void processRequests();
+
+  QThreadPool thread_pool_;
+
+  QMutex mutex_;
+  QList<Request> queued_requests_;
+  int num_active_workers_{0};
+
+  // Keys of all queued or running requests (only used from the GUI thread)
+  QSet<QString> requested_keys_;
+};
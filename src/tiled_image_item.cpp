@@ -0,0 +1,192 @@
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+
+#include "tiled_image_item.h"
+
+TiledImageItem::TiledImageItem(const QImage& image, QGraphicsItem* parent)
+    : QGraphicsObject(parent),
+      image_(image),
+      tiles_(256 * 1024 * 1024)
+{
+  // Needed to get the exposed rect in paint()
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+
+  level_sizes_.push_back(image_.size());
+  while (level_sizes_.back().width() > tile_size || level_sizes_.back().height() > tile_size)
+  {
+    const QSize& previous_size = level_sizes_.back();
+    level_sizes_.push_back(QSize(std::max(1, previous_size.width() / 2), std::max(1, previous_size.height() / 2)));
+  }
+
+  level_images_.resize(level_sizes_.size());
+}
+
+QRectF TiledImageItem::boundingRect() const
+{
+  return QRectF(QPointF(0, 0), image_.size());
+}
+
+void TiledImageItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+  // Use the coarsest level that still has at least one pixel per screen pixel
+  const qreal level_of_detail = option->levelOfDetailFromTransform(painter->worldTransform());
+
+  int level = 0;
+  while (level + 1 < int(level_sizes_.size()) && level_of_detail * std::pow(2.0, level + 1) <= 1.0)
+  {
+    level++;
+  }
+
+  const QRectF exposed_rect = option->exposedRect.intersected(boundingRect());
+
+  const auto drawTiles = [&](const int tiles_level, const QRectF& item_rect, const bool request_missing_tiles)
+  {
+    const qreal scale_x = qreal(level_sizes_[tiles_level].width()) / image_.width();
+    const qreal scale_y = qreal(level_sizes_[tiles_level].height()) / image_.height();
+
+    const int num_tiles_x = (level_sizes_[tiles_level].width() + tile_size - 1) / tile_size;
+    const int num_tiles_y = (level_sizes_[tiles_level].height() + tile_size - 1) / tile_size;
+
+    const int first_tile_x = std::clamp(int(item_rect.left() * scale_x) / tile_size, 0, num_tiles_x - 1);
+    const int last_tile_x = std::clamp(int(std::ceil(item_rect.right() * scale_x)) / tile_size, 0, num_tiles_x - 1);
+    const int first_tile_y = std::clamp(int(item_rect.top() * scale_y) / tile_size, 0, num_tiles_y - 1);
+    const int last_tile_y = std::clamp(int(std::ceil(item_rect.bottom() * scale_y)) / tile_size, 0, num_tiles_y - 1);
+
+    QList<QRectF> missing_rects;
+
+    for (int tile_y = first_tile_y; tile_y <= last_tile_y; tile_y++)
+    {
+      for (int tile_x = first_tile_x; tile_x <= last_tile_x; tile_x++)
+      {
+        const QRectF tile_rect = tileRect(tiles_level, tile_x, tile_y);
+        const QRectF target_rect = tile_rect.intersected(item_rect);
+
+        if (target_rect.isEmpty())
+        {
+          continue;
+        }
+
+        const QPixmap* tile_pixmap = request_missing_tiles ? tile(tiles_level, tile_x, tile_y)
+                                                           : tiles_.object(tileKey(tiles_level, tile_x, tile_y));
+
+        if (tile_pixmap)
+        {
+          const qreal pixmap_scale_x = tile_pixmap->width() / tile_rect.width();
+          const qreal pixmap_scale_y = tile_pixmap->height() / tile_rect.height();
+
+          const QRectF source_rect((target_rect.left() - tile_rect.left()) * pixmap_scale_x,
+                                   (target_rect.top() - tile_rect.top()) * pixmap_scale_y,
+                                   target_rect.width() * pixmap_scale_x,
+                                   target_rect.height() * pixmap_scale_y);
+
+          painter->drawPixmap(target_rect, *tile_pixmap, source_rect);
+        }
+        else
+        {
+          missing_rects.push_back(target_rect);
+        }
+      }
+    }
+
+    return missing_rects;
+  };
+
+  QList<QRectF> missing_rects = drawTiles(level, exposed_rect, true);
+
+  // Fill the gaps with the tiles of coarser levels, as far as they are ready
+  for (int coarser_level = level + 1; coarser_level < int(level_sizes_.size()) && !missing_rects.isEmpty(); coarser_level++)
+  {
+    QList<QRectF> still_missing_rects;
+    for (const QRectF& missing_rect : missing_rects)
+    {
+      still_missing_rects.append(drawTiles(coarser_level, missing_rect, false));
+    }
+    missing_rects = still_missing_rects;
+  }
+}
+
+QFuture<QImage> TiledImageItem::levelImage(const int level)
+{
+  if (!level_images_[level].isValid())
+  {
+    if (level == 0)
+    {
+      level_images_[level] = QtConcurrent::run([image = image_]() { return image; });
+    }
+    else
+    {
+      // A QFuture can only have one continuation, so the level is waited for instead.
+      // The previous level was queued before, so this never waits for a task that did not start yet.
+      level_images_[level] = QtConcurrent::run(
+          [previous_level_image = levelImage(level - 1), level_size = level_sizes_[level]]()
+          { return previous_level_image.result().scaled(level_size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation); });
+    }
+  }
+
+  return level_images_[level];
+}
+
+QRectF TiledImageItem::tileRect(const int level, const int tile_x, const int tile_y) const
+{
+  const QSize& level_size = level_sizes_[level];
+
+  const qreal scale_x = qreal(image_.width()) / level_size.width();
+  const qreal scale_y = qreal(image_.height()) / level_size.height();
+
+  const int tile_width = std::min(tile_size, level_size.width() - tile_x * tile_size);
+  const int tile_height = std::min(tile_size, level_size.height() - tile_y * tile_size);
+
+  return QRectF(tile_x * tile_size * scale_x, tile_y * tile_size * scale_y, tile_width * scale_x, tile_height * scale_y);
+}
+
+const QPixmap* TiledImageItem::tile(const int level, const int tile_x, const int tile_y)
+{
+  if (const QPixmap* tile_pixmap = tiles_.object(tileKey(level, tile_x, tile_y)))
+  {
+    return tile_pixmap;
+  }
+
+  requestTile(level, tile_x, tile_y);
+
+  return nullptr;
+}
+
+void TiledImageItem::requestTile(const int level, const int tile_x, const int tile_y)
+{
+  const quint64 key = tileKey(level, tile_x, tile_y);
+
+  if (requested_tiles_.contains(key))
+  {
+    return;
+  }
+
+  requested_tiles_.insert(key);
+
+  const QRect level_rect(tile_x * tile_size, tile_y * tile_size, tile_size, tile_size);
+
+  QtConcurrent::run(
+      [level_image_future = levelImage(level), level_rect]()
+      {
+        const QImage level_image = level_image_future.result();
+        return level_image.copy(level_rect.intersected(level_image.rect()));
+      })
+      .then(this,
+            [this, key, tile_rect = tileRect(level, tile_x, tile_y)](const QImage& tile_image)
+            {
+              // Pixmaps can only be created in the GUI thread
+              QPixmap* tile_pixmap = new QPixmap(QPixmap::fromImage(tile_image));
+              tiles_.insert(key, tile_pixmap, tile_image.sizeInBytes());
+
+              requested_tiles_.remove(key);
+              update(tile_rect);
+            });
+}
+
+quint64 TiledImageItem::tileKey(const int level, const int tile_x, const int tile_y)
+{
+  return (quint64(level) << 48) | (quint64(tile_x) << 24) | quint64(tile_y);
+}
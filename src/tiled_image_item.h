@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QCache>
+#include <QFuture>
+#include <QGraphicsObject>
+#include <QImage>
+#include <QPixmap>
+#include <QSet>
+#include <QSize>
+
+#include <vector>
+
+// Shows a (very large) image as tiles of a mip-map pyramid, instead of one QPixmap of the full image.
+// Only the tiles that are visible at the current zoom level are created and uploaded as pixmaps.
+// The pyramid levels and the tiles are created lazily in the background. Until a tile is ready,
+// the part of a coarser tile is drawn instead.
+class TiledImageItem : public QGraphicsObject
+{
+  Q_OBJECT
+
+public:
+  explicit TiledImageItem(const QImage& image, QGraphicsItem* parent = nullptr);
+
+  QRectF boundingRect() const override;
+  void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+  static constexpr int tile_size = 512;
+
+private:
+  // Level 0 is the full resolution, every following level has half the size of the previous one
+  QFuture<QImage> levelImage(const int level);
+
+  // Item coordinates of a tile
+  QRectF tileRect(const int level, const int tile_x, const int tile_y) const;
+
+  const QPixmap* tile(const int level, const int tile_x, const int tile_y);
+  void requestTile(const int level, const int tile_x, const int tile_y);
+
+  static quint64 tileKey(const int level, const int tile_x, const int tile_y);
+
+  const QImage image_;
+
+  std::vector<QSize> level_sizes_;
+  std::vector<QFuture<QImage>> level_images_;
+
+  QCache<quint64, QPixmap> tiles_;
+  QSet<quint64> requested_tiles_;
+};
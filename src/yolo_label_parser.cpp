@@ -0,0 +1,142 @@
+#include <QFile>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+
+#include "yolo_label_parser.h"
+
+namespace
+{
+struct Field
+{
+  const char* begin;
+  const char* end;
+};
+
+bool isSpace(const char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool parseNumber(const Field& field, int& value)
+{
+  const auto [end, error] = std::from_chars(field.begin, field.end, value);
+  return error == std::errc() && end == field.end;
+}
+
+bool parseNumber(const Field& field, float& value)
+{
+#if defined(__cpp_lib_to_chars)
+  const auto [end, error] = std::from_chars(field.begin, field.end, value);
+  return error == std::errc() && end == field.end;
+#else
+  // Standard libraries without floating point from_chars (e.g. older libc++), does not allocate either
+  bool ok = false;
+  value = QByteArrayView(field.begin, field.end - field.begin).toFloat(&ok);
+  return ok;
+#endif
+}
+} // namespace
+
+YoloLabels YoloLabelParser::parse(QByteArrayView data)
+{
+  YoloLabels labels;
+
+  const char* position = data.data();
+  const char* const data_end = data.data() + data.size();
+
+  // Only the first fields are used (segmentation labels have more)
+  std::array<Field, 6> fields;
+
+  int line_number = 0;
+  while (position < data_end)
+  {
+    const char* const line_end = std::find(position, data_end, '\n');
+    line_number++;
+
+    int num_fields = 0;
+
+    const char* field_begin = position;
+    while (true)
+    {
+      while (field_begin < line_end && isSpace(*field_begin))
+      {
+        field_begin++;
+      }
+
+      if (field_begin == line_end)
+      {
+        break;
+      }
+
+      const char* field_end = field_begin;
+      while (field_end < line_end && !isSpace(*field_end))
+      {
+        field_end++;
+      }
+
+      if (num_fields < int(fields.size()))
+      {
+        fields[num_fields] = {field_begin, field_end};
+      }
+      num_fields++;
+
+      field_begin = field_end;
+    }
+
+    position = (line_end == data_end) ? data_end : line_end + 1;
+
+    // Empty lines are fine
+    if (num_fields == 0)
+    {
+      continue;
+    }
+
+    if (num_fields < 5)
+    {
+      labels.errors.push_back(QString("line %1: expected at least 5 fields, got %2").arg(line_number).arg(num_fields));
+      continue;
+    }
+
+    YoloAnnotation annotation;
+
+    if (!parseNumber(fields[0], annotation.label_id) || !parseNumber(fields[1], annotation.x_center) ||
+        !parseNumber(fields[2], annotation.y_center) || !parseNumber(fields[3], annotation.width) ||
+        !parseNumber(fields[4], annotation.height))
+    {
+      labels.errors.push_back(QString("line %1: invalid number").arg(line_number));
+      continue;
+    }
+
+    if (!std::isfinite(annotation.x_center) || !std::isfinite(annotation.y_center) || !std::isfinite(annotation.width) ||
+        !std::isfinite(annotation.height))
+    {
+      labels.errors.push_back(QString("line %1: found nan or inf").arg(line_number));
+      continue;
+    }
+
+    // An invalid confidence is ignored, the box itself is still fine
+    float confidence;
+    if (num_fields == 6 && parseNumber(fields[5], confidence) && std::isfinite(confidence))
+    {
+      annotation.confidence = confidence;
+    }
+
+    labels.annotations.push_back(annotation);
+  }
+
+  return labels;
+}
+
+YoloLabels YoloLabelParser::parseFile(const QString& label_filename)
+{
+  QFile file(label_filename);
+  if (!file.open(QIODevice::ReadOnly))
+  {
+    return {};
+  }
+
+  return parse(file.readAll());
+}
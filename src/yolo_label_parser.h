@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QByteArrayView>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <optional>
+
+// One line of a YOLO label file (coordinates relative to the image size)
+struct YoloAnnotation
+{
+  int label_id{0};
+  float x_center{0.f};
+  float y_center{0.f};
+  float width{0.f};
+  float height{0.f};
+
+  // Only written for predictions
+  std::optional<float> confidence;
+};
+
+struct YoloLabels
+{
+  QList<YoloAnnotation> annotations;
+
+  // One message per skipped line ("line <n>: <reason>")
+  QStringList errors;
+};
+
+// Parses YOLO label files directly from their bytes, without a QString per line or field.
+// Invalid lines (too few fields, no numbers, nan / inf) are skipped and reported in the errors.
+struct YoloLabelParser
+{
+  static YoloLabels parse(QByteArrayView data);
+
+  // No annotations (and no errors) if the file does not exist
+  static YoloLabels parseFile(const QString& label_filename);
+};